@@ -0,0 +1,149 @@
+/*
+
+Module: frames-bench.cpp
+
+Function:
+        Host throughput benchmark for cSHT3xFrames.
+
+Copyright and License:
+        See accompanying LICENSE file.
+
+Author:
+        Terry Moore, MCCI Corporation   June 2019
+
+Build:
+        From the top of the repository, for example:
+
+        g++ -std=c++14 -O2 -march=native -Isrc \
+                extras/bench/frames-bench.cpp src/lib/Catena-SHT3x-Frames.cpp \
+                -o frames-bench
+
+        Use -mssse3 (or no -m flags) in place of -march=native to measure
+        the other code paths.
+
+*/
+
+#include <Catena-SHT3x-Frames.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace McciCatenaSht3x;
+
+/****************************************************************************\
+|
+|   Code.
+|
+\****************************************************************************/
+
+namespace {
+
+// the CRC the device would send.
+std::uint8_t crcWord(std::uint8_t b0, std::uint8_t b1)
+    {
+    std::uint8_t crc8 = 0xFF;
+    std::uint8_t const b[2] = { b0, b1 };
+
+    for (unsigned i = 0; i < 2; ++i)
+        {
+        crc8 ^= b[i];
+        for (unsigned j = 0; j < 8; ++j)
+            crc8 = (crc8 & 0x80) ? std::uint8_t((crc8 << 1) ^ 0x31) : std::uint8_t(crc8 << 1);
+        }
+
+    return crc8;
+    }
+
+// make nFrames pseudo-random frames, with about one in 16 corrupted.
+std::vector<std::uint8_t> makeFrames(size_t nFrames)
+    {
+    std::vector<std::uint8_t> frames(nFrames * cSHT3xFrames::kFrameSize);
+    std::uint32_t seed = 0x5EED;
+
+    for (size_t i = 0; i < nFrames; ++i)
+        {
+        std::uint8_t * const p = &frames[i * cSHT3xFrames::kFrameSize];
+
+        seed = seed * 1664525u + 1013904223u;
+        p[0] = std::uint8_t(seed >> 24);
+        p[1] = std::uint8_t(seed >> 16);
+        p[3] = std::uint8_t(seed >> 8);
+        p[4] = std::uint8_t(seed >> 0);
+        p[2] = crcWord(p[0], p[1]);
+        p[5] = crcWord(p[3], p[4]);
+
+        seed = seed * 1664525u + 1013904223u;
+        if ((seed >> 28) == 0)
+            p[(seed >> 16) % cSHT3xFrames::kFrameSize] ^= std::uint8_t(1u << ((seed >> 8) & 7));
+        }
+
+    return frames;
+    }
+
+// check that decode() and decodeScalar() agree exactly.
+template <typename T>
+bool checkIdentical(const std::vector<std::uint8_t> &frames, size_t nFrames)
+    {
+    std::vector<T> t1(nFrames), rh1(nFrames), t2(nFrames), rh2(nFrames);
+    std::vector<std::uint8_t> v1((nFrames + 7) / 8), v2((nFrames + 7) / 8);
+
+    size_t const n1 = cSHT3xFrames::decode(frames.data(), nFrames, t1.data(), rh1.data(), v1.data());
+    size_t const n2 = cSHT3xFrames::decodeScalar(frames.data(), nFrames, t2.data(), rh2.data(), v2.data());
+
+    return n1 == n2 &&
+           std::memcmp(t1.data(), t2.data(), nFrames * sizeof(T)) == 0 &&
+           std::memcmp(rh1.data(), rh2.data(), nFrames * sizeof(T)) == 0 &&
+           std::memcmp(v1.data(), v2.data(), v1.size()) == 0;
+    }
+
+// time nRounds decodes of the frames, and print a JSON line.
+template <typename T, typename F>
+void bench(const char *pName, const std::vector<std::uint8_t> &frames, size_t nFrames, unsigned nRounds, F decode)
+    {
+    std::vector<T> t(nFrames), rh(nFrames);
+    std::vector<std::uint8_t> valid((nFrames + 7) / 8);
+    size_t nValid = 0;
+
+    auto const start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < nRounds; ++i)
+        nValid += decode(frames.data(), nFrames, t.data(), rh.data(), valid.data());
+    auto const stop = std::chrono::steady_clock::now();
+
+    double const sec = std::chrono::duration<double>(stop - start).count();
+    double const nTotal = double(nFrames) * nRounds;
+
+    std::printf(
+        "{\"bench\":\"%s\",\"impl\":\"%s\",\"frames\":%.0f,\"valid\":%zu,"
+        "\"sec\":%.6f,\"frames_per_sec\":%.0f,\"ns_per_frame\":%.3f}\n",
+        pName, cSHT3xFrames::getImplementation(), nTotal, nValid,
+        sec, nTotal / sec, sec * 1e9 / nTotal
+        );
+    }
+
+} // end anonymous namespace
+
+int main(int argc, char **argv)
+    {
+    size_t const nFrames = argc > 1 ? size_t(std::strtoul(argv[1], nullptr, 0)) : 1000003;
+    unsigned const nRounds = argc > 2 ? unsigned(std::strtoul(argv[2], nullptr, 0)) : 20;
+    std::vector<std::uint8_t> const frames = makeFrames(nFrames);
+
+    if (! checkIdentical<float>(frames, nFrames) ||
+        ! checkIdentical<std::int32_t>(frames, nFrames))
+        {
+        std::fprintf(stderr, "decode() and decodeScalar() disagree\n");
+        return 1;
+        }
+
+    using DecodeFloat = size_t (*)(const std::uint8_t *, size_t, float *, float *, std::uint8_t *);
+    using DecodeFixed = size_t (*)(const std::uint8_t *, size_t, std::int32_t *, std::int32_t *, std::uint8_t *);
+
+    bench<float>("float", frames, nFrames, nRounds, DecodeFloat(&cSHT3xFrames::decode));
+    bench<float>("float-scalar", frames, nFrames, nRounds, DecodeFloat(&cSHT3xFrames::decodeScalar));
+    bench<std::int32_t>("fixed", frames, nFrames, nRounds, DecodeFixed(&cSHT3xFrames::decode));
+    bench<std::int32_t>("fixed-scalar", frames, nFrames, nRounds, DecodeFixed(&cSHT3xFrames::decodeScalar));
+    return 0;
+    }
@@ -0,0 +1,319 @@
+/*
+
+Module: sht3x-bench.cpp
+
+Function:
+        Host micro-benchmarks for the cSHT3x hot paths.
+
+Copyright and License:
+        See accompanying LICENSE file.
+
+Author:
+        Terry Moore, MCCI Corporation   June 2019
+
+Build:
+        From the top of the repository:
+
+        g++ -std=c++14 -O2 -Iextras/host -Isrc \
+                extras/bench/sht3x-bench.cpp src/lib/Catena-SHT3x.cpp \
+                -o sht3x-bench
+
+Usage:
+        sht3x-bench [scale]
+
+        Prints one JSON line per benchmark:
+
+        ns_per_op               host CPU time per operation.
+        bus_bytes_per_op        bytes on the I2C bus per operation,
+                                counting the address byte of each transfer.
+        wall_us_per_op          modeled time per operation: the driver's
+                                delays plus bus time at the bus clock
+                                (9 bit times per byte, plus start and stop).
+
+        scale multiplies the iteration counts (default 1).
+
+*/
+
+#include <Catena-SHT3x.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <vector>
+
+using namespace McciCatenaSht3x;
+
+/****************************************************************************\
+|
+|   Manifest constants & typedefs.
+|
+\****************************************************************************/
+
+namespace {
+
+// a cSHT3x connected to a simulated sensor, with the bus time modeled on
+// the virtual clock. Also exposes the protected hot paths.
+class cBenchSht3x : public cSHT3x
+    {
+public:
+    cBenchSht3x(TwoWire &wire)
+        : cSHT3x(wire)
+        , m_lastCommand(0)
+        , m_sample(0)
+        , m_busBytes(0)
+        {}
+
+    using cSHT3x::crc;
+    using cSHT3x::processResultsRaw;
+
+    std::uint64_t getBusBytes() const { return this->m_busBytes; }
+
+protected:
+    virtual std::uint8_t busWrite(std::uint8_t, const std::uint8_t *pBuf, size_t nBuf) const override
+        {
+        this->bus(1 + nBuf);
+        this->m_lastCommand = std::uint16_t((pBuf[0] << 8) | pBuf[1]);
+        return 0;
+        }
+
+    virtual size_t busRead(std::uint8_t, std::uint8_t *pBuf, size_t nBuf, std::uint8_t &nReadFrom) const override
+        {
+        std::uint8_t frame[6];
+
+        if (this->m_lastCommand == std::uint16_t(Command::GetStatus))
+            {
+            frame[0] = 0x80;
+            frame[1] = 0x10;
+            }
+        else
+            {
+            ++this->m_sample;
+            frame[0] = std::uint8_t(0x66 + (this->m_sample & 0xF));
+            frame[1] = 0x55;
+            frame[3] = 0x80;
+            frame[4] = std::uint8_t(this->m_sample);
+            }
+
+        frame[2] = crc(frame, 2);
+        frame[5] = crc(frame + 3, 2);
+
+        for (size_t i = 0; i < nBuf && i < sizeof(frame); ++i)
+            pBuf[i] = frame[i];
+
+        this->bus(1 + nBuf);
+        nReadFrom = std::uint8_t(nBuf);
+        return nBuf;
+        }
+
+private:
+    void bus(size_t nBytes) const
+        {
+        std::uint32_t const hz = this->getBusClock() != 0 ? this->getBusClock() : 100000;
+        std::uint64_t const nBits = nBytes * 9 + 2;
+
+        this->m_busBytes += nBytes;
+        hostClockAdvance((nBits * 1000000 + hz - 1) / hz);
+        }
+
+    mutable std::uint16_t m_lastCommand;
+    mutable std::uint32_t m_sample;
+    mutable std::uint64_t m_busBytes;
+    };
+
+// keep the compiler from discarding results.
+volatile std::uint32_t gSink;
+
+/****************************************************************************\
+|
+|   Code.
+|
+\****************************************************************************/
+
+template <typename F>
+void bench(const char *pName, const cBenchSht3x &sht3x, std::uint64_t nOps, F op)
+    {
+    std::uint64_t const busStart = sht3x.getBusBytes();
+    std::uint64_t const usStart = hostClockMicros();
+
+    auto const start = std::chrono::steady_clock::now();
+    for (std::uint64_t i = 0; i < nOps; ++i)
+        op(i);
+    auto const stop = std::chrono::steady_clock::now();
+
+    double const ns = std::chrono::duration<double, std::nano>(stop - start).count();
+
+    std::printf(
+        "{\"bench\":\"%s\",\"ops\":%llu,\"ns_per_op\":%.3f,"
+        "\"bus_bytes_per_op\":%.3f,\"wall_us_per_op\":%.3f}\n",
+        pName,
+        (unsigned long long)nOps,
+        ns / double(nOps),
+        double(sht3x.getBusBytes() - busStart) / double(nOps),
+        double(hostClockMicros() - usStart) / double(nOps)
+        );
+    }
+
+} // end anonymous namespace
+
+int main(int argc, char **argv)
+    {
+    std::uint64_t const scale = argc > 1 ? std::strtoull(argv[1], nullptr, 0) : 1;
+    cBenchSht3x sht3x {Wire};
+    std::uint8_t frame[6] = { 0x66, 0x55, 0, 0x80, 0x01, 0 };
+    std::uint8_t status[3] = { 0x80, 0x10, 0 };
+
+    frame[2] = cBenchSht3x::crc(frame, 2);
+    frame[5] = cBenchSht3x::crc(frame + 3, 2);
+    status[2] = cBenchSht3x::crc(status, 2);
+
+    bench("crc-frame", sht3x, 10000000 * scale,
+        [&](std::uint64_t i)
+            {
+            frame[1] = std::uint8_t(i);
+            gSink = gSink + cBenchSht3x::crc(frame, 2) + cBenchSht3x::crc(frame + 3, 2);
+            });
+
+    bench("crc-status", sht3x, 10000000 * scale,
+        [&](std::uint64_t i)
+            {
+            status[1] = std::uint8_t(i);
+            gSink = gSink + cBenchSht3x::crc(status, 2);
+            });
+
+    bench("processResultsRaw", sht3x, 10000000 * scale,
+        [&](std::uint64_t i)
+            {
+            cSHT3x::MeasurementsRaw mRaw;
+
+            frame[4] = std::uint8_t(i);
+            gSink = gSink + sht3x.processResultsRaw(frame, mRaw) + mRaw.HumidityBits;
+            });
+
+    bench("rawTtoCelsius-sweep", sht3x, 100 * scale,
+        [&](std::uint64_t)
+            {
+            float sum = 0;
+
+            for (std::uint32_t v = 0; v < 0x10000; ++v)
+                sum += cSHT3x::rawTtoCelsius(std::uint16_t(v ^ gSink));
+            gSink = gSink + std::uint32_t(sum);
+            });
+
+    bench("rawRHtoPercent-sweep", sht3x, 100 * scale,
+        [&](std::uint64_t)
+            {
+            float sum = 0;
+
+            for (std::uint32_t v = 0; v < 0x10000; ++v)
+                sum += cSHT3x::rawRHtoPercent(std::uint16_t(v ^ gSink));
+            gSink = gSink + std::uint32_t(sum);
+            });
+
+    // inputs for the inverse conversions, computed outside the timed
+    // loops so that only the inverse is measured.
+    std::vector<float> celsius(0x10000);
+    std::vector<float> percentRH(0x10000);
+
+    for (std::uint32_t v = 0; v < 0x10000; ++v)
+        {
+        celsius[v] = cSHT3x::rawTtoCelsius(std::uint16_t(v));
+        percentRH[v] = cSHT3x::rawRHtoPercent(std::uint16_t(v));
+        }
+
+    bench("celsiusToRawT-sweep", sht3x, 100 * scale,
+        [&](std::uint64_t)
+            {
+            std::uint32_t sum = 0;
+
+            for (std::uint32_t v = 0; v < 0x10000; ++v)
+                sum += cSHT3x::celsiusToRawT(celsius[(v ^ gSink) & 0xFFFF]);
+            gSink = gSink + sum;
+            });
+
+    bench("percentRHtoRaw-sweep", sht3x, 100 * scale,
+        [&](std::uint64_t)
+            {
+            std::uint32_t sum = 0;
+
+            for (std::uint32_t v = 0; v < 0x10000; ++v)
+                sum += cSHT3x::percentRHtoRaw(percentRH[(v ^ gSink) & 0xFFFF]);
+            gSink = gSink + sum;
+            });
+
+    bench("getCommand", sht3x, 10000000 * scale,
+        [&](std::uint64_t i)
+            {
+            auto const p = static_cast<cSHT3x::Periodicity>((i + gSink) % 7);
+            auto const r = static_cast<cSHT3x::Repeatability>(((i >> 3) + gSink) % 4);
+            auto const s = static_cast<cSHT3x::ClockStretching>((i >> 5) & 1);
+
+            gSink = gSink + std::uint16_t(cSHT3x::getCommand(p, r, s));
+            });
+
+    // every command value (all 29, in the order of cSHT3x::Command),
+    // including those that aren't measurements.
+    static const cSHT3x::Command kCommands[] =
+        {
+        cSHT3x::Command::ModePeriodic_Medium_HalfHz, cSHT3x::Command::ModePeriodic_Low_HalfHz,
+        cSHT3x::Command::ModePeriodic_High_HalfHz, cSHT3x::Command::ModePeriodic_Medium_1Hz,
+        cSHT3x::Command::ModePeriodic_Low_1Hz, cSHT3x::Command::ModePeriodic_High_1Hz,
+        cSHT3x::Command::ModePeriodic_Medium_2Hz, cSHT3x::Command::ModePeriodic_Low_2Hz,
+        cSHT3x::Command::ModePeriodic_High_2Hz, cSHT3x::Command::ModePeriodic_Medium_4Hz,
+        cSHT3x::Command::ModePeriodic_Low_4Hz, cSHT3x::Command::ModePeriodic_High_4Hz,
+        cSHT3x::Command::ModeSingle_High_Nack, cSHT3x::Command::ModeSingle_Medium_Nack,
+        cSHT3x::Command::ModeSingle_Low_Nack, cSHT3x::Command::ModePeriodic_Medium_10Hz,
+        cSHT3x::Command::ModePeriodic_Low_10Hz, cSHT3x::Command::ModePeriodic_High_10Hz,
+        cSHT3x::Command::ModePeriodic_ART, cSHT3x::Command::ModeSingle_High_Stretch,
+        cSHT3x::Command::ModeSingle_Medium_Stretch, cSHT3x::Command::ModeSingle_Low_Stretch,
+        cSHT3x::Command::ClearStatus, cSHT3x::Command::HeaterDisable,
+        cSHT3x::Command::HeaterEnable, cSHT3x::Command::Break,
+        cSHT3x::Command::SoftReset, cSHT3x::Command::Fetch,
+        cSHT3x::Command::GetStatus,
+        };
+    constexpr unsigned nCommands = sizeof(kCommands) / sizeof(kCommands[0]);
+    static_assert(nCommands == 29, "kCommands must list every command");
+
+    bench("getPeriodicity", sht3x, 10000000 * scale,
+        [&](std::uint64_t i)
+            {
+            gSink = gSink + std::uint8_t(cSHT3x::getPeriodicity(kCommands[(i + gSink) % nCommands]));
+            });
+
+    bench("getRepeatability", sht3x, 10000000 * scale,
+        [&](std::uint64_t i)
+            {
+            gSink = gSink + std::uint8_t(cSHT3x::getRepeatability(kCommands[(i + gSink) % nCommands]));
+            });
+
+    for (std::uint32_t hz : { 100000u, 400000u, 1000000u })
+        {
+        char name[64];
+
+        // leave the periodic mode of the previous pass; the device
+        // doesn't accept single-shot commands while in it.
+        sht3x.reset();
+        sht3x.setBusClock(hz);
+
+        std::snprintf(name, sizeof(name), "getTemperatureHumidity-%lukHz", (unsigned long)(hz / 1000));
+        bench(name, sht3x, 1000000 * scale,
+            [&](std::uint64_t)
+                {
+                cSHT3x::Measurements m;
+
+                gSink = gSink + sht3x.getTemperatureHumidity(m) + std::uint32_t(m.Humidity);
+                });
+
+        sht3x.startPeriodicMeasurement(cSHT3x::Command::ModePeriodic_High_10Hz);
+        std::snprintf(name, sizeof(name), "getPeriodicMeasurement-%lukHz", (unsigned long)(hz / 1000));
+        bench(name, sht3x, 1000000 * scale,
+            [&](std::uint64_t)
+                {
+                cSHT3x::Measurements m;
+
+                gSink = gSink + sht3x.getPeriodicMeasurement(m) + std::uint32_t(m.Humidity);
+                });
+        }
+
+    return 0;
+    }
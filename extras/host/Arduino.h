@@ -0,0 +1,74 @@
+/*
+
+Module: Arduino.h
+
+Function:
+        Minimal Arduino environment for running the library on a host.
+
+Copyright and License:
+        See accompanying LICENSE file.
+
+Author:
+        Terry Moore, MCCI Corporation   June 2019
+
+Notes:
+        This is just enough of the Arduino API to compile and run the
+        library under Linux, for replay and benchmarks. Time is virtual:
+        it starts at zero, and only advances when the program calls
+        delay(), delayMicroseconds() or hostClockAdvance(). That keeps
+        replays deterministic.
+
+*/
+
+#ifndef _ARDUINO_H_
+# define _ARDUINO_H_
+# pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#define HEX 16
+#define DEC 10
+
+// the virtual clock, in microseconds.
+inline std::uint64_t &hostClockMicros()
+    {
+    static std::uint64_t us;
+    return us;
+    }
+
+inline void hostClockAdvance(std::uint64_t us) { hostClockMicros() += us; }
+
+inline std::uint32_t micros() { return std::uint32_t(hostClockMicros()); }
+inline std::uint32_t millis() { return std::uint32_t(hostClockMicros() / 1000); }
+inline void delay(std::uint32_t ms) { hostClockAdvance(std::uint64_t(ms) * 1000); }
+inline void delayMicroseconds(std::uint32_t us) { hostClockAdvance(us); }
+inline void yield() {}
+
+// Serial writes to stderr, so that it doesn't mix with program output.
+class HostSerial
+    {
+public:
+    void begin(unsigned long) {}
+    explicit operator bool() const { return true; }
+
+    void print(const char *s) { std::fputs(s, stderr); }
+    void print(char c) { std::fputc(c, stderr); }
+    void print(unsigned long v, int base = DEC) { std::fprintf(stderr, base == HEX ? "%lX" : "%lu", v); }
+    void print(long v, int base = DEC) { base == HEX ? this->print((unsigned long)v, base) : (void)std::fprintf(stderr, "%ld", v); }
+    void print(unsigned v, int base = DEC) { this->print((unsigned long)v, base); }
+    void print(int v, int base = DEC) { this->print((long)v, base); }
+    void print(double v, int digits = 2) { std::fprintf(stderr, "%.*f", digits, v); }
+
+    template <typename T>
+    void println(T v) { this->print(v); this->println(); }
+    template <typename T>
+    void println(T v, int base) { this->print(v, base); this->println(); }
+    void println() { std::fputc('\n', stderr); }
+    };
+
+static HostSerial Serial __attribute__((unused));
+
+#endif /* _ARDUINO_H_ */
@@ -0,0 +1,51 @@
+/*
+
+Module: Wire.h
+
+Function:
+        Stand-in TwoWire for running the library on a host.
+
+Copyright and License:
+        See accompanying LICENSE file.
+
+Author:
+        Terry Moore, MCCI Corporation   June 2019
+
+Notes:
+        There's no bus here: every transfer fails, as if nothing were
+        connected. Host programs run the driver through a subclass of
+        cSHT3x that overrides busWrite() and busRead(), such as
+        cSHT3xReplay.
+
+*/
+
+#ifndef _WIRE_H_
+# define _WIRE_H_
+# pragma once
+
+#include <Arduino.h>
+
+class TwoWire
+    {
+public:
+    void begin() {}
+    void end() {}
+    void setClock(std::uint32_t hz) { this->m_clock = hz; }
+    std::uint32_t getClock() const { return this->m_clock; }
+
+    void beginTransmission(std::uint8_t) {}
+    std::size_t write(std::uint8_t) { return 1; }
+    std::size_t write(const std::uint8_t *, std::size_t n) { return n; }
+    // 2: address NACK
+    std::uint8_t endTransmission(bool = true) { return 2; }
+    std::uint8_t requestFrom(std::uint8_t, std::uint8_t) { return 0; }
+    int available() { return 0; }
+    int read() { return -1; }
+
+private:
+    std::uint32_t m_clock = 100000;
+    };
+
+static TwoWire Wire __attribute__((unused));
+
+#endif /* _WIRE_H_ */
@@ -0,0 +1,204 @@
+/*
+
+Module: sht3x-replay.cpp
+
+Function:
+        Replay a captured I2C transaction log through cSHT3x on a host.
+
+Copyright and License:
+        See accompanying LICENSE file.
+
+Author:
+        Terry Moore, MCCI Corporation   June 2019
+
+Build:
+        From the top of the repository:
+
+        g++ -std=c++14 -O2 -Iextras/host -Isrc \
+                extras/replay/sht3x-replay.cpp \
+                src/lib/Catena-SHT3x.cpp src/lib/Catena-SHT3x-Replay.cpp \
+                -o sht3x-replay
+
+Usage:
+        sht3x-replay capture.bin
+
+        capture.bin is the array of cSHT3x::BusRecord collected by a
+        cSHT3x::BusCapture, written out as-is. The program works out from
+        each command which driver API produced it, calls that API, and
+        prints one JSON line per call: the command, the result, the bus
+        time in the capture, and the (virtual) time taken by this version
+        of the driver. Diff the output of two builds to compare them.
+
+*/
+
+#include <Catena-SHT3x-Replay.h>
+
+#include <cstdio>
+#include <vector>
+
+using namespace McciCatenaSht3x;
+
+/****************************************************************************\
+|
+|   Manifest constants & typedefs.
+|
+\****************************************************************************/
+
+namespace {
+
+// gives the program access to the raw command path, for commands that
+// aren't produced by a higher-level API.
+class cReplayDriver : public cSHT3xReplay
+    {
+public:
+    using cSHT3xReplay::cSHT3xReplay;
+
+    bool command(Command c) const { return this->writeCommand(c); }
+    bool response(std::uint8_t *pBuf, size_t nBuf) const { return this->readResponse(pBuf, nBuf); }
+    };
+
+/****************************************************************************\
+|
+|   Code.
+|
+\****************************************************************************/
+
+bool readCapture(const char *pPath, std::vector<cSHT3x::BusRecord> &records)
+    {
+    std::FILE * const pFile = std::fopen(pPath, "rb");
+    cSHT3x::BusRecord r;
+
+    if (pFile == nullptr)
+        return false;
+
+    while (std::fread(&r, sizeof(r), 1, pFile) == 1)
+        records.push_back(r);
+
+    std::fclose(pFile);
+    return true;
+    }
+
+std::uint16_t commandOf(const cSHT3x::BusRecord &r)
+    {
+    return std::uint16_t((r.Data[0] << 8) | r.Data[1]);
+    }
+
+bool isSingleNack(cSHT3x::Command c)
+    {
+    return cSHT3x::getPeriodicity(c) == cSHT3x::Periodicity::Single &&
+           cSHT3x::getClockStretching(c) == cSHT3x::ClockStretching::Disabled;
+    }
+
+} // end anonymous namespace
+
+int main(int argc, char **argv)
+    {
+    std::vector<cSHT3x::BusRecord> records;
+
+    if (argc != 2 || ! readCapture(argv[1], records))
+        {
+        std::fprintf(stderr, "usage: %s capture.bin\n", argv[0]);
+        return 1;
+        }
+
+    cReplayDriver sht3x {Wire, records.data(), records.size()};
+    unsigned nCalls = 0;
+
+    while (! sht3x.isDone())
+        {
+        size_t const iFirst = sht3x.getPosition();
+        const cSHT3x::BusRecord &first = records[iFirst];
+        std::uint64_t const usStart = hostClockMicros();
+        cSHT3x::MeasurementsRaw mRaw {};
+        const char *pApi;
+        bool fResult;
+        bool fData = false;
+        std::uint16_t c = 0;
+
+        if (first.Op != cSHT3x::BusOp::Write)
+            {
+            // a read with no command; perhaps the capture started mid-way.
+            std::uint8_t buf[sizeof(first.Data)];
+
+            pApi = "readResponse";
+            fResult = sht3x.response(buf, first.nData <= sizeof(buf) ? first.nData : sizeof(buf));
+            }
+        else
+            {
+            c = commandOf(first);
+            cSHT3x::Command const cmd = static_cast<cSHT3x::Command>(c);
+            bool const fNextIsPeriodic =
+                iFirst + 1 < records.size() &&
+                records[iFirst + 1].Op == cSHT3x::BusOp::Write &&
+                cSHT3x::PeriodicityToMillis(
+                    cSHT3x::getPeriodicity(static_cast<cSHT3x::Command>(commandOf(records[iFirst + 1])))
+                    ) != 0;
+
+            if (cmd == cSHT3x::Command::SoftReset)
+                {
+                pApi = "reset";
+                fResult = sht3x.reset();
+                }
+            else if (cmd == cSHT3x::Command::GetStatus)
+                {
+                cSHT3x::Status_t const s = sht3x.getStatus();
+
+                pApi = "getStatus";
+                fResult = s.isValid();
+                mRaw.TemperatureBits = s.getBits();
+                }
+            else if (cmd == cSHT3x::Command::Break && fNextIsPeriodic)
+                {
+                pApi = "startPeriodicMeasurement";
+                fResult = sht3x.startPeriodicMeasurement(
+                                static_cast<cSHT3x::Command>(commandOf(records[iFirst + 1]))
+                                ) != 0;
+                }
+            else if (cmd == cSHT3x::Command::Fetch)
+                {
+                pApi = "getPeriodicMeasurementRaw";
+                fResult = sht3x.getPeriodicMeasurementRaw(mRaw);
+                fData = true;
+                }
+            else if (isSingleNack(cmd))
+                {
+                pApi = "getTemperatureHumidityRaw";
+                fResult = sht3x.getTemperatureHumidityRaw(mRaw, cSHT3x::getRepeatability(cmd));
+                fData = true;
+                }
+            else
+                {
+                pApi = "writeCommand";
+                fResult = sht3x.command(cmd);
+                }
+            }
+
+        size_t const iLast = sht3x.getPosition() > iFirst ? sht3x.getPosition() - 1 : iFirst;
+
+        std::printf(
+            "{\"call\":%u,\"api\":\"%s\",\"cmd\":\"0x%04X\",\"ok\":%s",
+            nCalls++, pApi, c, fResult ? "true" : "false"
+            );
+        if (fData && fResult)
+            std::printf(",\"t\":%u,\"rh\":%u", mRaw.TemperatureBits, mRaw.HumidityBits);
+        else if (! fData && c == std::uint16_t(cSHT3x::Command::GetStatus))
+            std::printf(",\"status\":%u", mRaw.TemperatureBits);
+        std::printf(
+            ",\"records\":%zu,\"us_captured\":%u,\"us_replayed\":%llu}\n",
+            sht3x.getPosition() - iFirst,
+            unsigned(records[iLast].Timestamp - first.Timestamp),
+            (unsigned long long)(hostClockMicros() - usStart)
+            );
+
+        // make sure we always make progress.
+        if (sht3x.getPosition() == iFirst)
+            break;
+        }
+
+    std::printf(
+        "{\"summary\":true,\"calls\":%u,\"records\":%zu,\"replayed\":%zu,\"mismatches\":%u}\n",
+        nCalls, records.size(), sht3x.getPosition(), unsigned(sht3x.getMismatchCount())
+        );
+
+    return sht3x.getMismatchCount() == 0 && sht3x.isDone() ? 0 : 2;
+    }
@@ -0,0 +1,350 @@
+/*
+
+Module: sht3x-cache-test.cpp
+
+Function:
+        Host test for the cSHT3x latest-value cache.
+
+Copyright and License:
+        See accompanying LICENSE file.
+
+Author:
+        Terry Moore, MCCI Corporation   June 2019
+
+Build:
+        From the top of the repository:
+
+        g++ -std=c++14 -Iextras/host -Isrc \
+                extras/test/sht3x-cache-test.cpp src/lib/Catena-SHT3x.cpp \
+                -o sht3x-cache-test
+
+Usage:
+        sht3x-cache-test
+
+        Runs the driver's cache against a simulated sensor on the virtual
+        clock, and checks the hit, miss, coalescing, age and
+        repeatability rules. Prints each failed check; exits with
+        status 0 if all pass, 1 otherwise.
+
+*/
+
+#include <Catena-SHT3x.h>
+
+#include <cstdio>
+
+using namespace McciCatenaSht3x;
+
+/****************************************************************************\
+|
+|   Manifest constants & typedefs.
+|
+\****************************************************************************/
+
+namespace {
+
+// a cSHT3x connected to a simulated sensor. Single-shot results are
+// ready kSingleShotWaitMs after the command, and NACKed before. In
+// periodic mode, a sample is ready 15 ms into each period, and a Fetch
+// is NACKed if there's nothing new. Each sample has a serial number in
+// HumidityBits, and the repeatability it was taken with in
+// TemperatureBits.
+class cTestSht3x : public cSHT3x
+    {
+public:
+    cTestSht3x(TwoWire &wire)
+        : cSHT3x(wire)
+        , m_command(Command::Error)
+        , m_mode(Command::Error)
+        , m_modeStart(0)
+        , m_lastPeriod(-1)
+        , m_measureStart(0)
+        , m_serial(0)
+        , m_nMeasure(0)
+        , m_nFetch(0)
+        , m_nRead(0)
+        {}
+
+    std::uint32_t getMeasureCount() const { return this->m_nMeasure; }
+    std::uint32_t getFetchCount() const { return this->m_nFetch; }
+    std::uint32_t getReadCount() const { return this->m_nRead; }
+
+protected:
+    virtual std::uint8_t busWrite(std::uint8_t, const std::uint8_t *pBuf, size_t) const override
+        {
+        Command const c = Command((pBuf[0] << 8) | pBuf[1]);
+
+        this->m_command = c;
+        if (getPeriodicity(c) == Periodicity::Single)
+            {
+            ++this->m_nMeasure;
+            this->m_measureStart = millis();
+            }
+        else if (PeriodicityToMillis(getPeriodicity(c)) != 0)
+            {
+            this->m_mode = c;
+            this->m_modeStart = millis();
+            this->m_lastPeriod = -1;
+            }
+        else if (c == Command::Break || c == Command::SoftReset)
+            this->m_mode = Command::Error;
+        else if (c == Command::Fetch)
+            ++this->m_nFetch;
+
+        return 0;
+        }
+
+    virtual size_t busRead(std::uint8_t, std::uint8_t *pBuf, size_t nBuf, std::uint8_t &nReadFrom) const override
+        {
+        Command const c = this->m_command;
+        std::uint8_t frame[6];
+        Repeatability r;
+
+        ++this->m_nRead;
+        nReadFrom = 0;
+
+        // a command is answered once.
+        this->m_command = Command::Error;
+
+        if (c == Command::GetStatus)
+            {
+            frame[0] = 0x00;
+            frame[1] = 0x00;
+            r = Repeatability::NA;
+            }
+        else if (getPeriodicity(c) == Periodicity::Single)
+            {
+            if (millis() - this->m_measureStart < kWaitMs)
+                return 0;
+            r = getRepeatability(c);
+            }
+        else if (c == Command::Fetch && this->m_mode != Command::Error)
+            {
+            std::uint32_t const msPeriod = PeriodicityToMillis(getPeriodicity(this->m_mode));
+            std::uint32_t const msRun = millis() - this->m_modeStart;
+            std::int32_t const iPeriod = msRun < 15 ? -1 : std::int32_t((msRun - 15) / msPeriod);
+
+            if (iPeriod < 0 || iPeriod == this->m_lastPeriod)
+                return 0;
+            this->m_lastPeriod = iPeriod;
+            r = getRepeatability(this->m_mode);
+            }
+        else
+            return 0;
+
+        if (c != Command::GetStatus)
+            {
+            ++this->m_serial;
+            frame[0] = 0;
+            frame[1] = std::uint8_t(r);
+            frame[3] = std::uint8_t(this->m_serial >> 8);
+            frame[4] = std::uint8_t(this->m_serial);
+            }
+
+        frame[2] = crc(frame, 2);
+        frame[5] = crc(frame + 3, 2);
+
+        for (size_t i = 0; i < nBuf && i < sizeof(frame); ++i)
+            pBuf[i] = frame[i];
+
+        nReadFrom = std::uint8_t(nBuf);
+        return nBuf;
+        }
+
+private:
+    // must match the driver's wait for a single-shot measurement.
+    static constexpr std::uint32_t kWaitMs = 20;
+
+    mutable Command m_command;
+    mutable Command m_mode;
+    mutable std::uint32_t m_modeStart;
+    mutable std::int32_t m_lastPeriod;
+    mutable std::uint32_t m_measureStart;
+    mutable std::uint16_t m_serial;
+    mutable std::uint32_t m_nMeasure;
+    mutable std::uint32_t m_nFetch;
+    mutable std::uint32_t m_nRead;
+    };
+
+unsigned gFailures;
+
+void check(bool fOk, const char *pWhat, int line)
+    {
+    if (! fOk)
+        {
+        ++gFailures;
+        std::printf("FAIL line %d: %s\n", line, pWhat);
+        }
+    }
+
+#define CHECK(e)        check((e), #e, __LINE__)
+
+using CacheStatus = cSHT3x::CacheStatus;
+using Repeatability = cSHT3x::Repeatability;
+
+/****************************************************************************\
+|
+|   Code.
+|
+\****************************************************************************/
+
+// a miss starts one measurement; requests while it runs join it; once
+// it's done, requests within the max age are hits, with no bus traffic.
+void testCoalescing()
+    {
+    cTestSht3x sht3x {Wire};
+    cSHT3x::MeasurementsRaw m, m2;
+
+    CHECK(sht3x.requestCachedRaw(m, 1000) == CacheStatus::Pending);
+    delay(5);
+    CHECK(sht3x.requestCachedRaw(m, 1000) == CacheStatus::Pending);
+    CHECK(sht3x.getMeasureCount() == 1);
+    CHECK(sht3x.getReadCount() == 0);
+
+    delay(20);
+    CHECK(sht3x.requestCachedRaw(m, 1000) == CacheStatus::Ready);
+    CHECK(sht3x.getMeasureCount() == 1);
+
+    delay(500);
+    CHECK(sht3x.requestCachedRaw(m2, 1000) == CacheStatus::Ready);
+    CHECK(m2.HumidityBits == m.HumidityBits);
+    CHECK(sht3x.getReadCount() == 1);
+
+    CHECK(sht3x.getCacheMissCount() == 1);
+    CHECK(sht3x.getCacheCoalescedCount() == 2);
+    CHECK(sht3x.getCacheHitCount() == 1);
+
+    // too old now: the blocking form measures again.
+    delay(600);
+    CHECK(sht3x.getCachedRaw(m2, 1000));
+    CHECK(m2.HumidityBits != m.HumidityBits);
+    CHECK(sht3x.getMeasureCount() == 2);
+    }
+
+// the age of a result counts from when the conversion finished, so one
+// left pending too long is discarded, not returned as new.
+void testAge()
+    {
+    cTestSht3x sht3x {Wire};
+    cSHT3x::MeasurementsRaw m;
+
+    CHECK(sht3x.requestCachedRaw(m, 0) == CacheStatus::Pending);
+    delay(3600 * 1000u);
+    CHECK(sht3x.requestCachedRaw(m, 0) == CacheStatus::Pending);
+    CHECK(sht3x.getMeasureCount() == 2);
+    CHECK(sht3x.getReadCount() == 0);
+
+    // but a result collected promptly is good.
+    delay(20);
+    CHECK(sht3x.requestCachedRaw(m, 0) == CacheStatus::Ready);
+
+    // and one that has waited for longer than the max age is not.
+    CHECK(sht3x.requestCachedRaw(m, 100) == CacheStatus::Ready);
+    delay(101);
+    CHECK(sht3x.requestCachedRaw(m, 100) == CacheStatus::Pending);
+    }
+
+// a less repeatable sample, cached or pending, doesn't satisfy a request
+// for a more repeatable one; the reverse is fine.
+void testRepeatability()
+    {
+    cTestSht3x sht3x {Wire};
+    cSHT3x::MeasurementsRaw m;
+
+    CHECK(sht3x.requestCachedRaw(m, 1000, Repeatability::Low) == CacheStatus::Pending);
+    CHECK(sht3x.requestCachedRaw(m, 1000, Repeatability::High) == CacheStatus::Pending);
+    CHECK(sht3x.getMeasureCount() == 2);
+
+    // the low-repeatability caller joins the high-repeatability one.
+    delay(20);
+    CHECK(sht3x.requestCachedRaw(m, 1000, Repeatability::Low) == CacheStatus::Ready);
+    CHECK(m.TemperatureBits == std::uint16_t(Repeatability::High));
+    CHECK(sht3x.getMeasureCount() == 2);
+
+    CHECK(sht3x.getCachedRaw(m, 1000, Repeatability::Medium));
+    CHECK(sht3x.getMeasureCount() == 2);
+
+    // now cache a low-repeatability sample, and ask for better.
+    CHECK(sht3x.getTemperatureHumidityRaw(m, Repeatability::Low));
+    CHECK(sht3x.getMeasureCount() == 3);
+    CHECK(sht3x.getCachedRaw(m, 1000, Repeatability::High));
+    CHECK(m.TemperatureBits == std::uint16_t(Repeatability::High));
+    CHECK(sht3x.getMeasureCount() == 4);
+    }
+
+// another command abandons a pending measurement.
+void testAbandon()
+    {
+    cTestSht3x sht3x {Wire};
+    cSHT3x::MeasurementsRaw m;
+
+    CHECK(sht3x.requestCachedRaw(m, 1000) == CacheStatus::Pending);
+    CHECK(sht3x.getStatus().isValid());
+    delay(25);
+    CHECK(sht3x.requestCachedRaw(m, 1000) == CacheStatus::Pending);
+    CHECK(sht3x.getMeasureCount() == 2);
+
+    CHECK(sht3x.requestCachedRaw(m, 1000) == CacheStatus::Pending);
+    CHECK(sht3x.startPeriodicMeasurement(cSHT3x::Command::ModePeriodic_High_1Hz) != 0);
+    delay(25);
+    CHECK(sht3x.requestCachedRaw(m, 1000) == CacheStatus::Ready);
+    CHECK(sht3x.getFetchCount() == 1);
+    }
+
+// in periodic mode, fetch only when there can be a new sample; polling
+// faster than the period must neither fail nor look like bus errors.
+void testPeriodic()
+    {
+    cTestSht3x sht3x {Wire};
+    cSHT3x::MeasurementsRaw m;
+    unsigned nFail = 0;
+
+    sht3x.setBusClock(1000000);
+    sht3x.setBusClockTuning(true);
+    CHECK(sht3x.startPeriodicMeasurement(cSHT3x::Command::ModePeriodic_High_1Hz) == 1000);
+    delay(20);
+
+    for (unsigned i = 0; i < 200; ++i)
+        {
+        if (! sht3x.getCachedRaw(m, 100))
+            ++nFail;
+        delay(150);
+        }
+
+    CHECK(nFail == 0);
+    CHECK(sht3x.getFetchCount() <= 31);
+    CHECK(sht3x.getShortReadCount() == 0);
+    CHECK(sht3x.getBusClock() == 1000000);
+
+    // samples are dated at the end of their period: 600 ms into a
+    // period, the sample is 600 ms old, too old for a 500 ms max age;
+    // but there's no newer one, so it's returned without a fetch. At
+    // the next period boundary, a fetch is tried.
+    std::uint32_t const nFetch = sht3x.getFetchCount();
+    std::uint32_t const nHits = sht3x.getCacheHitCount();
+
+    CHECK(sht3x.startPeriodicMeasurement(cSHT3x::Command::ModePeriodic_High_1Hz) == 1000);
+    delay(20);
+    CHECK(sht3x.getCachedRaw(m, 0));
+    CHECK(sht3x.getFetchCount() == nFetch + 1);
+    delay(580);
+    CHECK(sht3x.getCachedRaw(m, 500));
+    CHECK(sht3x.getFetchCount() == nFetch + 1);
+    CHECK(sht3x.getCacheHitCount() == nHits + 1);
+    delay(400);
+    CHECK(sht3x.getCachedRaw(m, 500));
+    CHECK(sht3x.getFetchCount() == nFetch + 2);
+    }
+
+} // end anonymous namespace
+
+int main()
+    {
+    testCoalescing();
+    testAge();
+    testRepeatability();
+    testAbandon();
+    testPeriodic();
+
+    std::printf("%s: %u failure%s\n", gFailures == 0 ? "PASS" : "FAIL", gFailures, gFailures == 1 ? "" : "s");
+    return gFailures == 0 ? 0 : 1;
+    }
@@ -0,0 +1,96 @@
+/*
+
+Module: Catena-SHT3x-Frames.h
+
+Function:
+        Bulk decoding of raw SHT3x measurement frames (for gateways).
+
+Copyright and License:
+        See accompanying LICENSE file.
+
+Author:
+        Terry Moore, MCCI Corporation   June 2019
+
+*/
+
+#ifndef _CATENA_SHT3X_FRAMES_H_
+# define _CATENA_SHT3X_FRAMES_H_
+# pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatenaSht3x {
+
+// Decode arrays of 6-byte measurement frames, as read from the device:
+// T msb, T lsb, T CRC, RH msb, RH lsb, RH CRC. Frames are packed
+// back-to-back. Results are written as separate arrays (one entry per
+// frame), and a bit map of frames whose CRCs are both good: bit (i % 8)
+// of pValid[i / 8] is frame i. pValid must have room for (nFrames + 7) / 8
+// bytes. Values are converted whether or not the CRCs are good.
+//
+// The SIMD paths (SSSE3, AVX2; chosen at compile time) give results that
+// are bit-for-bit identical to the scalar path.
+class cSHT3xFrames
+    {
+public:
+    static constexpr size_t kFrameSize = 6;
+
+    // decode to Celsius and percent RH. Returns the number of valid frames.
+    static size_t decode(
+        const std::uint8_t *pFrames, size_t nFrames,
+        float *pT, float *pRH,
+        std::uint8_t *pValid
+        );
+
+    // decode to milli-Celsius and milli-percent RH. Returns the number of
+    // valid frames.
+    static size_t decode(
+        const std::uint8_t *pFrames, size_t nFrames,
+        std::int32_t *pmT, std::int32_t *pmRH,
+        std::uint8_t *pValid
+        );
+
+    // the same, always using the scalar code.
+    static size_t decodeScalar(
+        const std::uint8_t *pFrames, size_t nFrames,
+        float *pT, float *pRH,
+        std::uint8_t *pValid
+        );
+    static size_t decodeScalar(
+        const std::uint8_t *pFrames, size_t nFrames,
+        std::int32_t *pmT, std::int32_t *pmRH,
+        std::uint8_t *pValid
+        );
+
+    // name of the code path used by decode(): "avx2", "ssse3" or "scalar".
+    static const char *getImplementation();
+
+    // the conversions, same as cSHT3x::rawTtoCelsius() and
+    // cSHT3x::rawRHtoPercent().
+    static constexpr float rawTtoCelsius(std::uint16_t tfrac)
+        {
+        return -45.0f + 175.0f * (tfrac / 65535.0f);
+        }
+
+    static constexpr float rawRHtoPercent(std::uint16_t rhfrac)
+        {
+        return 100.0f * (rhfrac / 65535.0f);
+        }
+
+    // fixed-point conversions: 175000 / 65536 and 100000 / 65536, which
+    // is what Sensirion's reference driver uses.
+    static constexpr std::int32_t rawTtoMilliCelsius(std::uint16_t tfrac)
+        {
+        return ((21875 * std::int32_t(tfrac)) >> 13) - 45000;
+        }
+
+    static constexpr std::int32_t rawRHtoMilliPercent(std::uint16_t rhfrac)
+        {
+        return (12500 * std::int32_t(rhfrac)) >> 13;
+        }
+    };
+
+} // end namespace McciCatenaSht3x
+
+#endif /* undef(_CATENA_SHT3X_FRAMES_H_) */
@@ -0,0 +1,235 @@
+/*
+
+Module: Catena-SHT3x-Log.h
+
+Function:
+        Append-only block-structured log for SHT3x samples.
+
+Copyright and License:
+        See accompanying LICENSE file.
+
+Author:
+        Terry Moore, MCCI Corporation   June 2019
+
+*/
+
+#ifndef _CATENA_SHT3X_LOG_H_
+# define _CATENA_SHT3X_LOG_H_
+# pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if ! defined(ARDUINO)
+# include <vector>
+#endif
+
+namespace McciCatenaSht3x {
+
+// The storage underneath a log: an array of fixed-size blocks, each
+// of which is written whole. For flash, writeBlock() erases and then
+// programs the block.
+class cSHT3xLogStorage
+    {
+public:
+    virtual ~cSHT3xLogStorage() {}
+
+    // number of blocks available.
+    virtual std::uint32_t getBlockCount() const = 0;
+
+    // read nBuf bytes starting at offset within block iBlock.
+    virtual bool read(std::uint32_t iBlock, size_t offset, void *pBuf, size_t nBuf) = 0;
+
+    // write a whole block (cSHT3xLog::kBlockSize bytes).
+    virtual bool writeBlock(std::uint32_t iBlock, const void *pBlock) = 0;
+    };
+
+// The log itself. Samples are collected in RAM and each block is written
+// exactly once, when it fills or on flush(). Blocks are used round-robin,
+// so every block is erased equally often. Block n of the log lives in
+// storage block (Sequence % getBlockCount()).
+//
+// The format is little-endian, fixed-size and self-describing, so that
+// a whole log can be memory-mapped and scanned on the host.
+//
+// Wear is even only if blocks are mostly full when written. Every
+// flush() writes (and so erases) a whole block, however few samples it
+// holds, and the next sample starts a new one. A node that flushes one
+// sample before each sleep erases a block per sample, 120 times the
+// wear of full blocks, and holds only one sample per block. Such nodes
+// should keep the log object in memory that's retained during sleep,
+// and flush only when a block fills or before losing power.
+class cSHT3xLog
+    {
+public:
+    static constexpr size_t kBlockSize = 512;
+    static constexpr std::uint32_t kMagic = 0x474C3353;    // "S3LG"
+    static constexpr std::uint8_t kVersion = 1;
+
+    // the block header.
+    struct BlockHeader
+        {
+        std::uint32_t   Magic;          // kMagic
+        std::uint32_t   Sequence;       // block number, from zero
+        std::uint64_t   StartTime;      // time of first sample, in ms
+        std::uint32_t   PeriodMs;       // ms between samples
+        std::uint16_t   nSamples;       // samples in this block
+        std::uint8_t    Version;        // kVersion
+        std::uint8_t    Flags;          // reserved, 0xFF
+        std::uint32_t   Crc;            // crc32() of bytes [0..24) and the samples
+        std::uint32_t   Reserved;       // 0xFFFFFFFF
+        };
+
+    // a sample, as from cSHT3x::MeasurementsRaw.
+    struct Sample
+        {
+        std::uint16_t   TemperatureBits;
+        std::uint16_t   HumidityBits;
+        };
+
+    static constexpr size_t kSamplesPerBlock =
+        (kBlockSize - sizeof(BlockHeader)) / sizeof(Sample);
+
+    struct Block
+        {
+        BlockHeader     Header;
+        Sample          Samples[kSamplesPerBlock];
+        };
+
+    cSHT3xLog(cSHT3xLogStorage &storage)
+        : m_pStorage(&storage)
+        , m_sequence(0)
+        , m_runStart(0)
+        , m_runSamples(0)
+        , m_periodMs(0)
+        {
+        this->m_block.Header.nSamples = 0;
+        }
+
+    // neither copyable nor movable
+    cSHT3xLog(const cSHT3xLog&) = delete;
+    cSHT3xLog& operator=(const cSHT3xLog&) = delete;
+    cSHT3xLog(const cSHT3xLog&&) = delete;
+    cSHT3xLog& operator=(const cSHT3xLog&&) = delete;
+
+    // find the end of the existing log.
+    bool begin();
+
+    // start a run of samples taken every msPeriod ms (normally from
+    // cSHT3x::PeriodicityToMillis()), the first at msStart. Any pending
+    // samples are flushed.
+    bool startRun(std::uint64_t msStart, std::uint32_t msPeriod);
+
+    // append a sample to the current run; a block is written when full.
+    bool append(std::uint16_t tBits, std::uint16_t rhBits);
+
+    // write any pending samples as a (short) block. The next sample
+    // starts a new block, so no block is ever rewritten; but each call
+    // costs a full block erase (see above).
+    bool flush();
+
+    // sequence number of the next block to be written.
+    std::uint32_t getSequence() const { return this->m_sequence; }
+
+    // number of samples waiting in RAM.
+    size_t getPending() const { return this->m_block.Header.nSamples; }
+
+    // CRC-32 (IEEE 802.3), as used in the block header.
+    static std::uint32_t crc32(const void *pBuf, size_t nBuf, std::uint32_t crc = 0);
+
+    // compute the CRC of a block, using Header.nSamples.
+    static std::uint32_t blockCrc(const Block &block);
+
+    // check magic, version, sample count and CRC.
+    static bool isValidBlock(const Block &block);
+
+private:
+    cSHT3xLogStorage *m_pStorage;
+    std::uint32_t m_sequence;
+    std::uint64_t m_runStart;
+    std::uint32_t m_runSamples;
+    std::uint32_t m_periodMs;
+    Block m_block;
+    };
+
+static_assert(sizeof(cSHT3xLog::BlockHeader) == 32, "BlockHeader must be 32 bytes");
+static_assert(sizeof(cSHT3xLog::Block) == cSHT3xLog::kBlockSize, "Block must fill kBlockSize");
+
+#if ! defined(ARDUINO)
+
+// file-backed storage, for testing and for host tools.
+class cSHT3xLogFile : public cSHT3xLogStorage
+    {
+public:
+    cSHT3xLogFile() : m_pFile(nullptr), m_nBlocks(0) {}
+    virtual ~cSHT3xLogFile() { this->close(); }
+
+    // neither copyable nor movable
+    cSHT3xLogFile(const cSHT3xLogFile&) = delete;
+    cSHT3xLogFile& operator=(const cSHT3xLogFile&) = delete;
+    cSHT3xLogFile(const cSHT3xLogFile&&) = delete;
+    cSHT3xLogFile& operator=(const cSHT3xLogFile&&) = delete;
+
+    // open (or create) a file of nBlocks blocks; new space reads as
+    // erased flash (0xFF). If nBlocks is zero, use the existing size.
+    bool open(const char *pPath, std::uint32_t nBlocks);
+    void close();
+
+    virtual std::uint32_t getBlockCount() const override { return this->m_nBlocks; }
+    virtual bool read(std::uint32_t iBlock, size_t offset, void *pBuf, size_t nBuf) override;
+    virtual bool writeBlock(std::uint32_t iBlock, const void *pBlock) override;
+
+private:
+    void *m_pFile;
+    std::uint32_t m_nBlocks;
+    };
+
+// read-only view of a log file, memory-mapped. Valid blocks are
+// presented in sequence order.
+class cSHT3xLogReader
+    {
+public:
+    cSHT3xLogReader() : m_pMap(nullptr), m_nMap(0), m_nSamples(0) {}
+    ~cSHT3xLogReader() { this->close(); }
+
+    // neither copyable nor movable
+    cSHT3xLogReader(const cSHT3xLogReader&) = delete;
+    cSHT3xLogReader& operator=(const cSHT3xLogReader&) = delete;
+    cSHT3xLogReader(const cSHT3xLogReader&&) = delete;
+    cSHT3xLogReader& operator=(const cSHT3xLogReader&&) = delete;
+
+    // map the file, and index the valid blocks. If fVerify is false,
+    // CRCs are not checked (faster, for trusted files).
+    bool open(const char *pPath, bool fVerify = true);
+    void close();
+
+    size_t getBlockCount() const { return this->m_blocks.size(); }
+    const cSHT3xLog::Block &getBlock(size_t i) const { return *this->m_blocks[i]; }
+    std::uint64_t getSampleCount() const { return this->m_nSamples; }
+
+    // call f(msTime, sample) for every sample, oldest first.
+    template <typename F>
+    void forEachSample(F f) const
+        {
+        for (const cSHT3xLog::Block *pBlock : this->m_blocks)
+            {
+            std::uint64_t t = pBlock->Header.StartTime;
+            std::uint32_t const period = pBlock->Header.PeriodMs;
+
+            for (size_t i = 0; i < pBlock->Header.nSamples; ++i, t += period)
+                f(t, pBlock->Samples[i]);
+            }
+        }
+
+private:
+    void *m_pMap;
+    size_t m_nMap;
+    std::uint64_t m_nSamples;
+    std::vector<const cSHT3xLog::Block *> m_blocks;
+    };
+
+#endif /* ! defined(ARDUINO) */
+
+} // end namespace McciCatenaSht3x
+
+#endif /* undef(_CATENA_SHT3X_LOG_H_) */
@@ -0,0 +1,78 @@
+/*
+
+Module: Catena-SHT3x-Replay.h
+
+Function:
+        Replay of captured I2C transactions through cSHT3x.
+
+Copyright and License:
+        See accompanying LICENSE file.
+
+Author:
+        Terry Moore, MCCI Corporation   June 2019
+
+*/
+
+#ifndef _CATENA_SHT3X_REPLAY_H_
+# define _CATENA_SHT3X_REPLAY_H_
+# pragma once
+
+#include <Catena-SHT3x.h>
+
+namespace McciCatenaSht3x {
+
+// A cSHT3x whose bus is a log captured with cSHT3x::BusCapture. Each
+// write or read the driver makes consumes the next record, and gets the
+// recorded result; the bus itself is never touched. Timing comes only
+// from the driver's own calls to delay(), so a replay is deterministic.
+//
+// A write whose address or data differs from the record, or a transfer
+// that doesn't match the type of the next record, counts as a mismatch.
+// A mismatched write still consumes its record; a transfer of the wrong
+// type, or one past the end of the log, fails as if the device didn't
+// answer.
+class cSHT3xReplay : public cSHT3x
+    {
+public:
+    cSHT3xReplay(
+        TwoWire &wire,
+        const BusRecord *pRecords, size_t nRecords,
+        Address_t Address = Address_t::A
+        )
+        : cSHT3x(wire, Address)
+        , m_pRecords(pRecords)
+        , m_nRecords(nRecords)
+        , m_iNext(0)
+        , m_nMismatches(0)
+        {}
+
+    // start again at the first record.
+    void rewind() { this->m_iNext = 0; this->m_nMismatches = 0; }
+
+    // the next record to be replayed, or nullptr at the end.
+    const BusRecord *peek() const
+        {
+        return this->m_iNext < this->m_nRecords ? &this->m_pRecords[this->m_iNext]
+                                                : nullptr;
+        }
+
+    size_t getPosition() const { return this->m_iNext; }
+    bool isDone() const { return this->m_iNext >= this->m_nRecords; }
+    std::uint32_t getMismatchCount() const { return this->m_nMismatches; }
+
+protected:
+    virtual std::uint8_t busWrite(std::uint8_t addr, const std::uint8_t *pBuf, size_t nBuf) const override;
+    virtual size_t busRead(std::uint8_t addr, std::uint8_t *pBuf, size_t nBuf, std::uint8_t &nReadFrom) const override;
+
+private:
+    const BusRecord *next(BusOp op, std::uint8_t addr) const;
+
+    const BusRecord *m_pRecords;
+    size_t m_nRecords;
+    mutable size_t m_iNext;
+    mutable std::uint32_t m_nMismatches;
+    };
+
+} // end namespace McciCatenaSht3x
+
+#endif /* undef(_CATENA_SHT3X_REPLAY_H_) */
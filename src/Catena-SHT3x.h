@@ -68,6 +68,26 @@ class cSHT3x
 private:
     static constexpr bool kfDebug = false;
 
+    // bus clock tuning: transactions per evaluation window, and the
+    // number of errors in a window that forces a step down (a corrected
+    // CRC counts as half an error). The limit is lowered only after
+    // kBusStepFailuresMax step downs from the same clock, and is raised
+    // again for a retry after kBusReprobeWindows clean windows at it.
+    static constexpr std::uint16_t kBusWindow = 32;
+    static constexpr std::uint16_t kBusErrorsMax = 2;
+    static constexpr std::uint8_t kBusStepFailuresMax = 3;
+    static constexpr std::uint16_t kBusReprobeWindows = 64;
+    static constexpr std::uint8_t kBusClockUnmanaged = 0xFF;
+
+    // how long to wait for a single-shot measurement without clock
+    // stretching.
+    static constexpr std::uint32_t kSingleShotWaitMs = 20;
+
+    // typical supply currents from the datasheet, in uA.
+    static constexpr float kMeasureMicroAmps = 600.0f;
+    static constexpr float kSingleIdleMicroAmps = 0.2f;
+    static constexpr float kPeriodicIdleMicroAmps = 45.0f;
+
 public:
     // the address type:
     enum class Address_t : std::int8_t
@@ -86,7 +106,39 @@ public:
             : m_wire(&wire),
               m_address(Address),
               m_pinAlert(pinAlert),
-              m_pinReset(pinReset) {}
+              m_pinReset(pinReset),
+              m_noCrc(false),
+              m_fCrcCorrect(false),
+              m_pTrace(nullptr),
+              m_pCapture(nullptr),
+              m_periodicCommand(Command::Error),
+              m_planCommand(Command::Error),
+              m_lastCommand(Command::Error),
+              m_periodicStart(0),
+              m_fPeriodicPhaseKnown(false),
+              m_fBusTuning(false),
+              m_busClockStep(kBusClockUnmanaged),
+              m_busClockLimit(kBusClockSteps - 1),
+              m_busWindowCount(0),
+              m_busWindowErrors(0),
+              m_busFailStep(kBusClockUnmanaged),
+              m_busFailCount(0),
+              m_busCleanWindows(0),
+              m_nShortReads(0),
+              m_nNoData(0),
+              m_nCrcErrors(0),
+              m_nCrcCorrected(0),
+              m_nCrcUncorrectable(0),
+              m_fLastCrcCorrected(false),
+              m_fCacheValid(false),
+              m_fCachePending(false),
+              m_cacheRepeatability(Repeatability::Error),
+              m_cachePendingRepeatability(Repeatability::Error),
+              m_cacheTime(0),
+              m_cachePendingTime(0),
+              m_nCacheHits(0),
+              m_nCacheMisses(0),
+              m_nCacheCoalesced(0) {}
 
     // neither copyable nor movable
     cSHT3x(const cSHT3x&) = delete;
@@ -94,6 +146,8 @@ public:
     cSHT3x(const cSHT3x&&) = delete;
     cSHT3x& operator=(const cSHT3x&&) = delete;
 
+    virtual ~cSHT3x() {}
+
     static constexpr float rawTtoCelsius(std::uint16_t tfrac)
         {
         return -45.0f + 175.0f * (tfrac / 65535.0f);
@@ -131,6 +185,7 @@ public:
         {
         std::uint16_t   TemperatureBits;
         std::uint16_t   HumidityBits;
+        bool            CrcCorrected;   // true if CRC correction repaired either word
         void extract(std::uint16_t &a_t, std::uint16_t &a_rh) const
             {
             a_t = this->TemperatureBits;
@@ -143,10 +198,12 @@ public:
         {
         float Temperature;
         float Humidity;
+        bool CrcCorrected;
         void set(const MeasurementsRaw &mRaw)
             {
             this->Temperature = rawTtoCelsius(mRaw.TemperatureBits);
             this->Humidity = rawRHtoPercent(mRaw.HumidityBits);
+            this->CrcCorrected = mRaw.CrcCorrected;
             }
         void extract(float &a_t, float &a_rh) const
             {
@@ -484,6 +541,64 @@ public:
             }
         }
 
+    // the bus clock steps used by the clock tuning logic.
+    static constexpr std::uint8_t kBusClockSteps = 3;
+
+    static constexpr std::uint32_t getBusClockStep(std::uint8_t i)
+        {
+        return i == 0 ? 100000
+             : i == 1 ? 400000
+             : i == 2 ? 1000000
+             : 0
+             ;
+        }
+
+    // return the highest step whose clock doesn't exceed hz (at least step 0)
+    static constexpr std::uint8_t busClockToStep(std::uint32_t hz)
+        {
+        return hz >= getBusClockStep(2) ? 2
+             : hz >= getBusClockStep(1) ? 1
+             : 0
+             ;
+        }
+
+    // measurement duration in microseconds, typical or maximum, from
+    // the datasheet.
+    static constexpr std::uint32_t getMeasurementMicros(Repeatability r, bool fMax = true)
+        {
+        return r == Repeatability::Low    ? (fMax ?  4000 :  2500)
+             : r == Repeatability::Medium ? (fMax ?  6000 :  4500)
+             : r == Repeatability::High   ? (fMax ? 15000 : 12500)
+             : 0
+             ;
+        }
+
+    // what the client needs from planSampling().
+    struct SamplingRequirements
+        {
+        std::uint32_t   msInterval;     // need a sample at least this often
+        Repeatability   repeatability;  // at least this repeatable
+        std::uint32_t   msLatency;      // longest acceptable wait for a sample
+        std::uint32_t   maxBusClock;    // fastest usable I2C clock; 0 for any
+        };
+
+    // the result of planSampling().
+    struct SamplingPlan
+        {
+        Command         command;        // the measurement command to use
+        std::uint32_t   busClock;       // the I2C clock to use, in Hz
+        std::uint32_t   msLatency;      // estimated wait for a sample
+        float           uaAverage;      // estimated average sensor current
+        float           busMsPerHour;   // estimated I2C bus time
+        };
+
+    // choose the single-shot or periodic command, repeatability, clock
+    // stretching and I2C clock that meet req with the least sensor
+    // current. Returns false if nothing meets the interval and latency
+    // requirements, or if req.maxBusClock is below 100 kHz (the slowest
+    // clock the library uses).
+    static bool planSampling(const SamplingRequirements &req, SamplingPlan &plan);
+
     // status bits
     class Status_t {
     public:
@@ -510,9 +625,159 @@ public:
         std::uint32_t m_Status;
         };
 
+    // the events recorded by the trace facility.
+    enum class TraceEvent : std::uint8_t
+        {
+        Error = 0,
+        WriteCommand,       // Result is endTransmission() result
+        ReadResponse,       // Result is requestFrom() result
+        CheckCrc,           // Result is mask of words with bad CRC, and
+                            // (shifted left 4) of corrected words
+        };
+
+    // a trace record: 8 bytes, no padding, host byte order.
+    struct TraceRecord
+        {
+        std::uint16_t   Timestamp;      // low 16 bits of millis()
+        std::uint16_t   Command;        // most recent command written
+        TraceEvent      Event;          // what happened
+        std::uint8_t    Result;         // event-specific result
+        std::uint8_t    nRequested;     // bytes (or CRC words) requested
+        std::uint8_t    nActual;        // bytes (or CRC words) that were ok
+        };
+
+    // a trace ring buffer; the client supplies the storage. Once full,
+    // the oldest records are overwritten.
+    class Trace {
+    public:
+        Trace(TraceRecord *pBuf, size_t nRecords)
+            : m_pBuf(pBuf)
+            , m_nRecords(nRecords)
+            , m_iNext(0)
+            , m_nTotal(0)
+            , m_Command(0)
+            , m_fEnabled(false)
+            {}
+
+        template <size_t a_nRecords>
+        Trace(TraceRecord (&buf)[a_nRecords])
+            : Trace(buf, a_nRecords)
+            {}
+
+        // neither copyable nor movable
+        Trace(const Trace&) = delete;
+        Trace& operator=(const Trace&) = delete;
+        Trace(const Trace&&) = delete;
+        Trace& operator=(const Trace&&) = delete;
+
+        void setEnabled(bool fEnabled) { this->m_fEnabled = fEnabled; }
+        bool isEnabled() const { return this->m_fEnabled; }
+
+        // discard all records.
+        void clear() { this->m_iNext = 0; this->m_nTotal = 0; }
+
+        // number of records the buffer can hold.
+        size_t capacity() const { return this->m_nRecords; }
+
+        // number of records currently held.
+        size_t size() const
+            {
+            return this->m_nTotal < this->m_nRecords ? this->m_nTotal
+                                                     : this->m_nRecords;
+            }
+
+        // number of records put since clear(); anything beyond
+        // capacity() has been overwritten.
+        std::uint32_t getTotal() const { return this->m_nTotal; }
+
+        // get record i, counting from the oldest record still held.
+        bool get(size_t i, TraceRecord &r) const;
+
+        // append a record.
+        void put(TraceEvent e, std::uint8_t result, std::uint8_t nRequested, std::uint8_t nActual);
+
+        // note the command that subsequent records refer to.
+        void setCommand(std::uint16_t c) { this->m_Command = c; }
+
+    private:
+        TraceRecord *m_pBuf;
+        size_t m_nRecords;
+        size_t m_iNext;
+        std::uint32_t m_nTotal;
+        std::uint16_t m_Command;
+        bool m_fEnabled;
+        };
+
+    // the bus operations captured by BusCapture
+    enum class BusOp : std::uint8_t
+        {
+        Error = 0,
+        Write,              // Result is endTransmission() result
+        Read,               // Result is requestFrom() result
+        };
+
+    // a bus transaction: 16 bytes, no padding, host byte order.
+    struct BusRecord
+        {
+        std::uint32_t   Timestamp;      // micros()
+        BusOp           Op;             // write or read
+        std::uint8_t    Address;        // I2C address
+        std::uint8_t    Result;         // op-specific result
+        std::uint8_t    nData;          // bytes written or received
+        std::uint8_t    Data[8];        // the first bytes of the data
+        };
+
+    // a transaction log, for later replay with cSHT3xReplay. The client
+    // supplies the storage; once it's full, further transactions are
+    // counted but not recorded.
+    class BusCapture {
+    public:
+        BusCapture(BusRecord *pBuf, size_t nRecords)
+            : m_pBuf(pBuf)
+            , m_nCapacity(nRecords)
+            , m_nRecords(0)
+            , m_nDropped(0)
+            , m_fEnabled(false)
+            {}
+
+        template <size_t a_nRecords>
+        BusCapture(BusRecord (&buf)[a_nRecords])
+            : BusCapture(buf, a_nRecords)
+            {}
+
+        // neither copyable nor movable
+        BusCapture(const BusCapture&) = delete;
+        BusCapture& operator=(const BusCapture&) = delete;
+        BusCapture(const BusCapture&&) = delete;
+        BusCapture& operator=(const BusCapture&&) = delete;
+
+        void setEnabled(bool fEnabled) { this->m_fEnabled = fEnabled; }
+        bool isEnabled() const { return this->m_fEnabled; }
+
+        void clear() { this->m_nRecords = 0; this->m_nDropped = 0; }
+        size_t capacity() const { return this->m_nCapacity; }
+        size_t size() const { return this->m_nRecords; }
+        std::uint32_t getDropped() const { return this->m_nDropped; }
+        const BusRecord *data() const { return this->m_pBuf; }
+
+        void put(BusOp op, std::uint8_t addr, std::uint8_t result, const std::uint8_t *pData, size_t nData);
+
+    private:
+        BusRecord *m_pBuf;
+        size_t m_nCapacity;
+        size_t m_nRecords;
+        std::uint32_t m_nDropped;
+        bool m_fEnabled;
+        };
+
     // start operation.
     bool begin();
 
+    // start operation, attaching to a sensor that may have kept running
+    // while the MCU slept. cRetained is the value of getPeriodicCommand()
+    // saved before sleeping, or Command::Error.
+    bool beginFast(Command cRetained = Command::Error);
+
     // end operation.
     void end();
 
@@ -527,11 +792,55 @@ public:
     // start a measurement, and return the millis to delay between
     // measurements
     std::uint32_t startPeriodicMeasurement(Command c) const;
+    // return the periodic measurement command in effect, or Command::Error.
+    Command getPeriodicCommand() const { return this->m_periodicCommand; }
     bool getPeriodicMeasurement(float &T, float &rh) const;
     bool getPeriodicMeasurement(Measurements &m) const;
     bool getPeriodicMeasurementRaw(std::uint16_t &tfrac, std::uint16_t &rhfrac) const;
     bool getPeriodicMeasurementRaw(MeasurementsRaw &mRaw) const;
 
+    // the result of requestCachedRaw()
+    enum class CacheStatus : std::uint8_t
+        {
+        Error, Ready, Pending,
+        };
+
+    // return the latest measurement if it's no more than msMaxAge ms
+    // old and at least as repeatable as r (Ready); age counts from when
+    // the conversion finished, not from when it was read. Otherwise start a single-shot measurement,
+    // or join the one already in progress, and return Pending: call
+    // again later. A finished measurement that has waited unread for
+    // more than msMaxAge is discarded, and a new one started. Any other
+    // command sent to the device abandons a pending measurement.
+    //
+    // In periodic mode, a miss fetches the latest periodic result
+    // instead, but only if the device can have a newer sample than the
+    // cached one; otherwise (or if the fetch finds no new data) the
+    // cached sample is returned, as it's the newest there is. Periodic
+    // samples are dated at the end of the period that produced them, and
+    // have the repeatability of the periodic mode, whatever r is.
+    CacheStatus requestCachedRaw(MeasurementsRaw &mRaw, std::uint32_t msMaxAge, Repeatability r = Repeatability::High) const;
+    // the same, but wait for a measurement if need be.
+    bool getCachedRaw(MeasurementsRaw &mRaw, std::uint32_t msMaxAge, Repeatability r = Repeatability::High) const;
+    bool getCached(Measurements &m, std::uint32_t msMaxAge, Repeatability r = Repeatability::High) const;
+
+    // forget the cached measurement.
+    void invalidateCache() { this->m_fCacheValid = false; }
+
+    // cache statistics: fresh results returned, measurements started
+    // (or fetched), and requests that found a measurement in progress.
+    std::uint32_t getCacheHitCount() const { return this->m_nCacheHits; }
+    std::uint32_t getCacheMissCount() const { return this->m_nCacheMisses; }
+    std::uint32_t getCacheCoalescedCount() const { return this->m_nCacheCoalesced; }
+
+    // make plan the active configuration: set the bus clock, and start
+    // (or stop) periodic measurement.
+    bool applySamplingPlan(const SamplingPlan &plan);
+    // take a measurement according to the active plan (or, if none,
+    // as for getTemperatureHumidity()).
+    bool getMeasurement(Measurements &m) const;
+    bool getMeasurementRaw(MeasurementsRaw &mRaw) const;
+
     bool setCrcMode(bool newMode)
         {
         bool const oldMode = ! this->m_noCrc;
@@ -541,6 +850,46 @@ public:
 
     bool getCrcMode() const { return !this->m_noCrc; }
 
+    // enable or disable correction of single-bit errors found by CRC
+    // checks. Returns the previous setting. Note that correction trades
+    // detection for repair: without it, every error of one, two or three
+    // bits in a word and its CRC is rejected; with it, about one in six
+    // three-bit errors looks like a one-bit error, and is "corrected" to
+    // wrong data. Check CrcCorrected on each sample if that matters.
+    bool setCrcCorrection(bool fCorrect)
+        {
+        bool const oldMode = this->m_fCrcCorrect;
+        this->m_fCrcCorrect = fCorrect;
+        return oldMode;
+        }
+
+    bool getCrcCorrection() const { return this->m_fCrcCorrect; }
+
+    // true if the most recent measurement or status read from the device
+    // was corrected. Each measurement also carries its own CrcCorrected
+    // flag, which stays with it (e.g. in the cache).
+    bool getLastCrcCorrected() const { return this->m_fLastCrcCorrected; }
+
+    // the CRC mismatch caused by flipping bit iBit of a 16-bit word.
+    // Single-bit errors in the CRC itself give a one-bit mismatch; as
+    // the polynomial includes (x + 1), every single-bit mismatch has an
+    // odd number of bits and every double-bit mismatch an even number,
+    // so double-bit errors are never mistaken for single-bit errors.
+    static constexpr std::uint8_t getCrcSyndrome(std::uint8_t iBit)
+        {
+        std::uint16_t const w = std::uint16_t(1u << iBit);
+        std::uint8_t crc8 = 0;
+
+        for (int i = 15; i >= 0; --i)
+            {
+            bool const fFeedback = ((crc8 >> 7) ^ (w >> i)) & 1;
+
+            crc8 = std::uint8_t((crc8 << 1) ^ (fFeedback ? 0x31 : 0));
+            }
+
+        return crc8;
+        }
+
     bool setHeater(bool fOn) const
             {
             return this->writeCommand(
@@ -553,14 +902,105 @@ public:
 
     static constexpr bool isDebug() { return kfDebug; }
 
+    // attach a trace buffer (or nullptr to detach). Recording is
+    // controlled at run time by pTrace->setEnabled().
+    void setTrace(Trace *pTrace) { this->m_pTrace = pTrace; }
+    Trace *getTrace() const { return this->m_pTrace; }
+
+    // attach a bus capture buffer (or nullptr to detach).
+    void setBusCapture(BusCapture *pCapture) { this->m_pCapture = pCapture; }
+    BusCapture *getBusCapture() const { return this->m_pCapture; }
+
+    // set the I2C clock, rounded down to a supported step. Until this or
+    // setBusClockTuning() is called, the library leaves the clock alone.
+    void setBusClock(std::uint32_t hz);
+    // return the I2C clock, or zero if the library isn't managing it.
+    std::uint32_t getBusClock() const
+        {
+        return this->m_busClockStep == kBusClockUnmanaged
+                    ? 0
+                    : getBusClockStep(this->m_busClockStep)
+                    ;
+        }
+
+    // set the highest clock that tuning may use. Tuning lowers this
+    // limit when a clock keeps failing, and periodically retries the
+    // next faster one, so getBusClockLimit() is the stable speed for
+    // this board, suitable for saving.
+    void setBusClockLimit(std::uint32_t hz);
+    std::uint32_t getBusClockLimit() const
+        { return getBusClockStep(this->m_busClockLimit); }
+
+    // enable or disable clock tuning based on observed error rates.
+    void setBusClockTuning(bool fEnable);
+    bool getBusClockTuning() const { return this->m_fBusTuning; }
+
+    // error counters
+    std::uint32_t getShortReadCount() const { return this->m_nShortReads; }
+    // Fetch reads NACKed because no new periodic sample was ready; these
+    // are not bus errors, and aren't counted as short reads.
+    std::uint32_t getNoDataCount() const { return this->m_nNoData; }
+    std::uint32_t getCrcErrorCount() const { return this->m_nCrcErrors; }
+    std::uint32_t getCrcCorrectedCount() const { return this->m_nCrcCorrected; }
+    std::uint32_t getCrcUncorrectableCount() const { return this->m_nCrcUncorrectable; }
+
 protected:
+    // the bus primitives. busWrite() returns the endTransmission() result;
+    // busRead() returns the number of bytes received (at most nBuf are
+    // stored) and sets nReadFrom to the requestFrom() result. Override
+    // these to run the driver against something other than a TwoWire.
+    virtual std::uint8_t busWrite(std::uint8_t addr, const std::uint8_t *pBuf, size_t nBuf) const;
+    virtual size_t busRead(std::uint8_t addr, std::uint8_t *pBuf, size_t nBuf, std::uint8_t &nReadFrom) const;
+
+    std::uint32_t startPeriodic(Command c, bool fBreak) const;
+    bool getSingleMeasurementRaw(Command c, MeasurementsRaw &mRaw) const;
+    bool completeCached(MeasurementsRaw &mRaw) const;
+    std::uint32_t getPeriodicSampleTime(std::uint32_t now) const;
+    void updateCache(const MeasurementsRaw &mRaw, std::uint32_t msTime, Repeatability r) const
+        {
+        this->m_cache = mRaw;
+        this->m_cacheTime = msTime;
+        this->m_cacheRepeatability = r;
+        this->m_fCacheValid = true;
+        }
     bool writeCommand(Command c) const;
     bool readResponse(std::uint8_t *buf, size_t nBuf) const;
     bool processResultsRaw(const std::uint8_t (&buf)[6], std::uint16_t &t, std::uint16_t &rh) const;
     bool processResultsRaw(const std::uint8_t (&buf)[6], MeasurementsRaw &mRaw) const;
     static std::uint8_t crc(const std::uint8_t *buf, size_t nBuf, std::uint8_t crc8 = 0xFF);
+
+    enum class CrcCheck : std::uint8_t
+        {
+        Ok, Corrected, Bad,
+        };
+    // check a word against its CRC, correcting it if enabled and possible.
+    CrcCheck checkCrc(std::uint16_t &word, std::uint8_t crc8) const;
     std::int8_t getAddress() const
         { return static_cast<std::int8_t>(this->m_address); }
+    void capture(BusOp op, std::uint8_t addr, std::uint8_t result, const std::uint8_t *pData, size_t nData) const
+        {
+        if (this->m_pCapture != nullptr && this->m_pCapture->isEnabled())
+            this->m_pCapture->put(op, addr, result, pData, nData);
+        }
+    // the outcome of a transfer, for clock tuning.
+    enum class BusResult : std::uint8_t
+        {
+        Ok, Marginal, Error,
+        };
+    void noteBusResult(BusResult result) const;
+    void resetBusTuning() const
+        {
+        this->m_busWindowCount = this->m_busWindowErrors = 0;
+        this->m_busFailStep = kBusClockUnmanaged;
+        this->m_busFailCount = 0;
+        this->m_busCleanWindows = 0;
+        }
+    void applyBusClock() const;
+    void trace(TraceEvent e, std::uint8_t result, std::uint8_t nRequested, std::uint8_t nActual) const
+        {
+        if (this->m_pTrace != nullptr && this->m_pTrace->isEnabled())
+            this->m_pTrace->put(e, result, nRequested, nActual);
+        }
 
 private:
     TwoWire *m_wire;
@@ -568,6 +1008,38 @@ private:
     Pin_t m_pinAlert;
     Pin_t m_pinReset;
     bool m_noCrc;
+    bool m_fCrcCorrect;
+    Trace *m_pTrace;
+    BusCapture *m_pCapture;
+    mutable Command m_periodicCommand;
+    Command m_planCommand;
+    mutable Command m_lastCommand;
+    mutable std::uint32_t m_periodicStart;
+    mutable bool m_fPeriodicPhaseKnown;
+    mutable bool m_fBusTuning;
+    mutable std::uint8_t m_busClockStep;
+    mutable std::uint8_t m_busClockLimit;
+    mutable std::uint16_t m_busWindowCount;
+    mutable std::uint16_t m_busWindowErrors;    // in half errors
+    mutable std::uint8_t m_busFailStep;
+    mutable std::uint8_t m_busFailCount;
+    mutable std::uint16_t m_busCleanWindows;
+    mutable std::uint32_t m_nShortReads;
+    mutable std::uint32_t m_nNoData;
+    mutable std::uint32_t m_nCrcErrors;
+    mutable std::uint32_t m_nCrcCorrected;
+    mutable std::uint32_t m_nCrcUncorrectable;
+    mutable bool m_fLastCrcCorrected;
+    mutable bool m_fCacheValid;
+    mutable bool m_fCachePending;
+    mutable Repeatability m_cacheRepeatability;
+    mutable Repeatability m_cachePendingRepeatability;
+    mutable MeasurementsRaw m_cache;
+    mutable std::uint32_t m_cacheTime;
+    mutable std::uint32_t m_cachePendingTime;
+    mutable std::uint32_t m_nCacheHits;
+    mutable std::uint32_t m_nCacheMisses;
+    mutable std::uint32_t m_nCacheCoalesced;
     };
 
 } // end namespace McciCatenaSht3x
@@ -0,0 +1,495 @@
+/*
+
+Module: Catena-SHT3x-Frames.cpp
+
+Function:
+        Code for bulk decoding of SHT3x measurement frames.
+
+Copyright and License:
+        See accompanying LICENSE file.
+
+Author:
+        Terry Moore, MCCI Corporation   June 2019
+
+*/
+
+#include <Catena-SHT3x-Frames.h>
+
+// The SIMD and scalar paths must do exactly the same float operations
+// to give identical results, so don't let the compiler fuse the scalar
+// multiply and add.
+#if defined(__clang__)
+# pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+# pragma GCC optimize ("fp-contract=off")
+#endif
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSSE3__)
+# include <tmmintrin.h>
+#endif
+
+using namespace McciCatenaSht3x;
+
+
+namespace {
+
+// CRC of a two-byte word, same as cSHT3x::crc() with crc8 == 0xFF.
+inline std::uint8_t crcWord(std::uint8_t b0, std::uint8_t b1)
+    {
+    /* see CRC-8-Calc.md for a little info on this */
+    static const std::uint8_t crcTable[16] =
+        {
+        0x00, 0x31, 0x62, 0x53, 0xc4, 0xf5, 0xa6, 0x97,
+        0xb9, 0x88, 0xdb, 0xea, 0x7d, 0x4c, 0x1f, 0x2e,
+        };
+    std::uint8_t crc8 = 0xFF;
+
+    crc8 = (crc8 << 4) ^ crcTable[(b0 ^ crc8) >> 4];
+    crc8 = (crc8 << 4) ^ crcTable[((crc8 >> 4) ^ b0) & 0xF];
+    crc8 = (crc8 << 4) ^ crcTable[(b1 ^ crc8) >> 4];
+    crc8 = (crc8 << 4) ^ crcTable[((crc8 >> 4) ^ b1) & 0xF];
+    return crc8;
+    }
+
+inline void convert(std::uint16_t t, std::uint16_t rh, float &T, float &RH)
+    {
+    T = cSHT3xFrames::rawTtoCelsius(t);
+    RH = cSHT3xFrames::rawRHtoPercent(rh);
+    }
+
+inline void convert(std::uint16_t t, std::uint16_t rh, std::int32_t &mT, std::int32_t &mRH)
+    {
+    mT = cSHT3xFrames::rawTtoMilliCelsius(t);
+    mRH = cSHT3xFrames::rawRHtoMilliPercent(rh);
+    }
+
+// decode frames [iFrame, nFrames); iFrame must be a multiple of 8.
+template <typename T>
+size_t decodeRange(
+    const std::uint8_t *pFrames, size_t iFrame, size_t nFrames,
+    T *pT, T *pRH,
+    std::uint8_t *pValid
+    )
+    {
+    size_t nValid = 0;
+
+    for (size_t i = iFrame; i < nFrames; ++i)
+        {
+        const std::uint8_t * const p = pFrames + i * cSHT3xFrames::kFrameSize;
+        std::uint8_t const bit = std::uint8_t(1u << (i & 7));
+
+        if (bit == 1)
+            pValid[i / 8] = 0;
+
+        convert(
+            std::uint16_t((p[0] << 8) | p[1]),
+            std::uint16_t((p[3] << 8) | p[4]),
+            pT[i], pRH[i]
+            );
+
+        if (crcWord(p[0], p[1]) == p[2] && crcWord(p[3], p[4]) == p[5])
+            {
+            pValid[i / 8] |= bit;
+            ++nValid;
+            }
+        }
+
+    return nValid;
+    }
+
+#if defined(__SSSE3__)
+
+unsigned countBits(unsigned v)
+    {
+    unsigned n;
+
+    for (n = 0; v != 0; ++n)
+        v &= v - 1;
+
+    return n;
+    }
+
+// Nibble tables for the linear part of the CRC of a word; the CRC of
+// (b0, b1) is 0x81 ^ k0[b1 & 0xF] ^ k1[b1 >> 4] ^ k2[b0 & 0xF] ^ k3[b0 >> 4].
+// (0x81 is the CRC of 0x0000.) This is the same nibble-at-a-time idea as
+// cSHT3x::crc(), but with one table per nibble position, so that every
+// lookup can be done in parallel with pshufb.
+alignas(16) const std::uint8_t kCrcNibble[4][16] =
+    {
+    { 0x00, 0x31, 0x62, 0x53, 0xC4, 0xF5, 0xA6, 0x97, 0xB9, 0x88, 0xDB, 0xEA, 0x7D, 0x4C, 0x1F, 0x2E },
+    { 0x00, 0x43, 0x86, 0xC5, 0x3D, 0x7E, 0xBB, 0xF8, 0x7A, 0x39, 0xFC, 0xBF, 0x47, 0x04, 0xC1, 0x82 },
+    { 0x00, 0xF4, 0xD9, 0x2D, 0x83, 0x77, 0x5A, 0xAE, 0x37, 0xC3, 0xEE, 0x1A, 0xB4, 0x40, 0x6D, 0x99 },
+    { 0x00, 0x6E, 0xDC, 0xB2, 0x89, 0xE7, 0x55, 0x3B, 0x23, 0x4D, 0xFF, 0x91, 0xAA, 0xC4, 0x76, 0x18 },
+    };
+
+// gather byte offLo (into the low byte) and byte offHi (into the high
+// byte) of each of 8 frames into 16-bit lanes, taking only the bytes
+// found in source bytes [base, base + 16).
+__m128i makeShuffle(unsigned base, unsigned offLo, unsigned offHi)
+    {
+    alignas(16) std::uint8_t m[16];
+
+    for (unsigned i = 0; i < 8; ++i)
+        {
+        unsigned const iLo = 6 * i + offLo;
+        unsigned const iHi = 6 * i + offHi;
+
+        m[2 * i + 0] = (iLo >= base && iLo < base + 16) ? std::uint8_t(iLo - base) : 0x80;
+        m[2 * i + 1] = (iHi >= base && iHi < base + 16) ? std::uint8_t(iHi - base) : 0x80;
+        }
+
+    return _mm_load_si128(reinterpret_cast<const __m128i *>(m));
+    }
+
+// splits 8 frames into T, RH and CRC words.
+class cDeinterleave
+    {
+public:
+    cDeinterleave()
+        {
+        for (unsigned i = 0; i < 3; ++i)
+            {
+            this->m_t[i] = makeShuffle(16 * i, 1, 0);
+            this->m_rh[i] = makeShuffle(16 * i, 4, 3);
+            this->m_crc[i] = makeShuffle(16 * i, 2, 5);
+            }
+        }
+
+    void split(const std::uint8_t *p, __m128i &t, __m128i &rh, __m128i &crc) const
+        {
+        __m128i const a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i const b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16));
+        __m128i const c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 32));
+
+        t = gather(a, b, c, this->m_t);
+        rh = gather(a, b, c, this->m_rh);
+        crc = gather(a, b, c, this->m_crc);
+        }
+
+private:
+    static __m128i gather(__m128i a, __m128i b, __m128i c, const __m128i (&m)[3])
+        {
+        return _mm_or_si128(
+                    _mm_or_si128(_mm_shuffle_epi8(a, m[0]), _mm_shuffle_epi8(b, m[1])),
+                    _mm_shuffle_epi8(c, m[2])
+                    );
+        }
+
+    __m128i m_t[3];
+    __m128i m_rh[3];
+    __m128i m_crc[3];
+    };
+
+#endif /* defined(__SSSE3__) */
+
+#if defined(__AVX2__)
+
+class cCrc
+    {
+public:
+    cCrc()
+        : m_k0(load(kCrcNibble[0]))
+        , m_k1(load(kCrcNibble[1]))
+        , m_k2(load(kCrcNibble[2]))
+        , m_k3(load(kCrcNibble[3]))
+        , m_crc0(_mm256_set1_epi16(0x81))
+        , m_nibble(_mm256_set1_epi8(0x0F))
+        , m_lowByte(_mm256_set1_epi16(0x00FF))
+        {}
+
+    // CRC of each 16-bit lane, in the low byte of the lane.
+    __m256i crc(__m256i w) const
+        {
+        __m256i const lo = _mm256_and_si256(w, this->m_nibble);
+        __m256i const hi = _mm256_and_si256(_mm256_srli_epi16(w, 4), this->m_nibble);
+        __m256i const even = _mm256_xor_si256(_mm256_shuffle_epi8(this->m_k0, lo), _mm256_shuffle_epi8(this->m_k1, hi));
+        __m256i const odd = _mm256_xor_si256(_mm256_shuffle_epi8(this->m_k2, lo), _mm256_shuffle_epi8(this->m_k3, hi));
+
+        return _mm256_xor_si256(
+                    _mm256_xor_si256(_mm256_and_si256(even, this->m_lowByte), _mm256_srli_epi16(odd, 8)),
+                    this->m_crc0
+                    );
+        }
+
+private:
+    static __m256i load(const std::uint8_t (&k)[16])
+        {
+        return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(k)));
+        }
+
+    __m256i m_k0, m_k1, m_k2, m_k3;
+    __m256i m_crc0;
+    __m256i m_nibble;
+    __m256i m_lowByte;
+    };
+
+inline void store(__m256i t, __m256i rh, float *pT, float *pRH)
+    {
+    __m256 const scale = _mm256_set1_ps(65535.0f);
+    __m256 const tMul = _mm256_set1_ps(175.0f);
+    __m256 const tAdd = _mm256_set1_ps(-45.0f);
+    __m256 const rhMul = _mm256_set1_ps(100.0f);
+
+    for (unsigned i = 0; i < 2; ++i)
+        {
+        __m128i const tHalf = i == 0 ? _mm256_castsi256_si128(t) : _mm256_extracti128_si256(t, 1);
+        __m128i const rhHalf = i == 0 ? _mm256_castsi256_si128(rh) : _mm256_extracti128_si256(rh, 1);
+        __m256 const tq = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(tHalf)), scale);
+        __m256 const rhq = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(rhHalf)), scale);
+
+        _mm256_storeu_ps(pT + 8 * i, _mm256_add_ps(tAdd, _mm256_mul_ps(tMul, tq)));
+        _mm256_storeu_ps(pRH + 8 * i, _mm256_mul_ps(rhMul, rhq));
+        }
+    }
+
+inline void store(__m256i t, __m256i rh, std::int32_t *pmT, std::int32_t *pmRH)
+    {
+    __m256i const tMul = _mm256_set1_epi32(21875);
+    __m256i const tAdd = _mm256_set1_epi32(-45000);
+    __m256i const rhMul = _mm256_set1_epi32(12500);
+
+    for (unsigned i = 0; i < 2; ++i)
+        {
+        __m128i const tHalf = i == 0 ? _mm256_castsi256_si128(t) : _mm256_extracti128_si256(t, 1);
+        __m128i const rhHalf = i == 0 ? _mm256_castsi256_si128(rh) : _mm256_extracti128_si256(rh, 1);
+        __m256i const t32 = _mm256_cvtepu16_epi32(tHalf);
+        __m256i const rh32 = _mm256_cvtepu16_epi32(rhHalf);
+
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(pmT + 8 * i),
+            _mm256_add_epi32(_mm256_srai_epi32(_mm256_mullo_epi32(t32, tMul), 13), tAdd)
+            );
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(pmRH + 8 * i),
+            _mm256_srai_epi32(_mm256_mullo_epi32(rh32, rhMul), 13)
+            );
+        }
+    }
+
+template <typename T>
+size_t decodeFrames(
+    const std::uint8_t *pFrames, size_t nFrames,
+    T *pT, T *pRH,
+    std::uint8_t *pValid
+    )
+    {
+    cDeinterleave const split;
+    cCrc const crc;
+    size_t nValid = 0;
+    size_t i;
+
+    for (i = 0; i + 16 <= nFrames; i += 16)
+        {
+        const std::uint8_t * const p = pFrames + i * cSHT3xFrames::kFrameSize;
+        __m128i t0, rh0, crc0, t1, rh1, crc1;
+
+        split.split(p, t0, rh0, crc0);
+        split.split(p + 8 * cSHT3xFrames::kFrameSize, t1, rh1, crc1);
+
+        __m256i const t = _mm256_inserti128_si256(_mm256_castsi128_si256(t0), t1, 1);
+        __m256i const rh = _mm256_inserti128_si256(_mm256_castsi128_si256(rh0), rh1, 1);
+        __m256i const got = _mm256_inserti128_si256(_mm256_castsi128_si256(crc0), crc1, 1);
+        __m256i const want = _mm256_or_si256(crc.crc(t), _mm256_slli_epi16(crc.crc(rh), 8));
+
+        // packs works within 128-bit lanes, so frames 0..7 land in bits
+        // 0..7 and frames 8..15 in bits 16..23.
+        unsigned const m = unsigned(_mm256_movemask_epi8(
+                                _mm256_packs_epi16(_mm256_cmpeq_epi16(want, got), _mm256_setzero_si256())
+                                ));
+
+        pValid[i / 8 + 0] = std::uint8_t(m);
+        pValid[i / 8 + 1] = std::uint8_t(m >> 16);
+        nValid += countBits(m);
+
+        store(t, rh, pT + i, pRH + i);
+        }
+
+    return nValid + decodeRange(pFrames, i, nFrames, pT, pRH, pValid);
+    }
+
+#elif defined(__SSSE3__)
+
+class cCrc
+    {
+public:
+    cCrc()
+        : m_k0(load(kCrcNibble[0]))
+        , m_k1(load(kCrcNibble[1]))
+        , m_k2(load(kCrcNibble[2]))
+        , m_k3(load(kCrcNibble[3]))
+        , m_crc0(_mm_set1_epi16(0x81))
+        , m_nibble(_mm_set1_epi8(0x0F))
+        , m_lowByte(_mm_set1_epi16(0x00FF))
+        {}
+
+    // CRC of each 16-bit lane, in the low byte of the lane.
+    __m128i crc(__m128i w) const
+        {
+        __m128i const lo = _mm_and_si128(w, this->m_nibble);
+        __m128i const hi = _mm_and_si128(_mm_srli_epi16(w, 4), this->m_nibble);
+        __m128i const even = _mm_xor_si128(_mm_shuffle_epi8(this->m_k0, lo), _mm_shuffle_epi8(this->m_k1, hi));
+        __m128i const odd = _mm_xor_si128(_mm_shuffle_epi8(this->m_k2, lo), _mm_shuffle_epi8(this->m_k3, hi));
+
+        return _mm_xor_si128(
+                    _mm_xor_si128(_mm_and_si128(even, this->m_lowByte), _mm_srli_epi16(odd, 8)),
+                    this->m_crc0
+                    );
+        }
+
+private:
+    static __m128i load(const std::uint8_t (&k)[16])
+        {
+        return _mm_load_si128(reinterpret_cast<const __m128i *>(k));
+        }
+
+    __m128i m_k0, m_k1, m_k2, m_k3;
+    __m128i m_crc0;
+    __m128i m_nibble;
+    __m128i m_lowByte;
+    };
+
+inline void store(__m128i t, __m128i rh, float *pT, float *pRH)
+    {
+    __m128i const zero = _mm_setzero_si128();
+    __m128 const scale = _mm_set1_ps(65535.0f);
+    __m128 const tMul = _mm_set1_ps(175.0f);
+    __m128 const tAdd = _mm_set1_ps(-45.0f);
+    __m128 const rhMul = _mm_set1_ps(100.0f);
+
+    for (unsigned i = 0; i < 2; ++i)
+        {
+        __m128i const t32 = i == 0 ? _mm_unpacklo_epi16(t, zero) : _mm_unpackhi_epi16(t, zero);
+        __m128i const rh32 = i == 0 ? _mm_unpacklo_epi16(rh, zero) : _mm_unpackhi_epi16(rh, zero);
+        __m128 const tq = _mm_div_ps(_mm_cvtepi32_ps(t32), scale);
+        __m128 const rhq = _mm_div_ps(_mm_cvtepi32_ps(rh32), scale);
+
+        _mm_storeu_ps(pT + 4 * i, _mm_add_ps(tAdd, _mm_mul_ps(tMul, tq)));
+        _mm_storeu_ps(pRH + 4 * i, _mm_mul_ps(rhMul, rhq));
+        }
+    }
+
+// there's no 32-bit multiply before SSE4.1, so split the constants:
+// (175000 * t) >> 16 == 2 * t + ((43928 * t) >> 16), and
+// (100000 * t) >> 16 == t + ((34464 * t) >> 16).
+inline void store(__m128i t, __m128i rh, std::int32_t *pmT, std::int32_t *pmRH)
+    {
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const tAdd = _mm_set1_epi32(-45000);
+    __m128i const tHi = _mm_mulhi_epu16(t, _mm_set1_epi16(short(43928)));
+    __m128i const rhHi = _mm_mulhi_epu16(rh, _mm_set1_epi16(short(34464)));
+
+    for (unsigned i = 0; i < 2; ++i)
+        {
+        __m128i const t32 = i == 0 ? _mm_unpacklo_epi16(t, zero) : _mm_unpackhi_epi16(t, zero);
+        __m128i const rh32 = i == 0 ? _mm_unpacklo_epi16(rh, zero) : _mm_unpackhi_epi16(rh, zero);
+        __m128i const tHi32 = i == 0 ? _mm_unpacklo_epi16(tHi, zero) : _mm_unpackhi_epi16(tHi, zero);
+        __m128i const rhHi32 = i == 0 ? _mm_unpacklo_epi16(rhHi, zero) : _mm_unpackhi_epi16(rhHi, zero);
+
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i *>(pmT + 4 * i),
+            _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(t32, 1), tHi32), tAdd)
+            );
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i *>(pmRH + 4 * i),
+            _mm_add_epi32(rh32, rhHi32)
+            );
+        }
+    }
+
+template <typename T>
+size_t decodeFrames(
+    const std::uint8_t *pFrames, size_t nFrames,
+    T *pT, T *pRH,
+    std::uint8_t *pValid
+    )
+    {
+    cDeinterleave const split;
+    cCrc const crc;
+    size_t nValid = 0;
+    size_t i;
+
+    for (i = 0; i + 8 <= nFrames; i += 8)
+        {
+        __m128i t, rh, got;
+
+        split.split(pFrames + i * cSHT3xFrames::kFrameSize, t, rh, got);
+
+        __m128i const want = _mm_or_si128(crc.crc(t), _mm_slli_epi16(crc.crc(rh), 8));
+        unsigned const m = unsigned(_mm_movemask_epi8(
+                                _mm_packs_epi16(_mm_cmpeq_epi16(want, got), _mm_setzero_si128())
+                                ));
+
+        pValid[i / 8] = std::uint8_t(m);
+        nValid += countBits(m);
+
+        store(t, rh, pT + i, pRH + i);
+        }
+
+    return nValid + decodeRange(pFrames, i, nFrames, pT, pRH, pValid);
+    }
+
+#else /* scalar */
+
+template <typename T>
+size_t decodeFrames(
+    const std::uint8_t *pFrames, size_t nFrames,
+    T *pT, T *pRH,
+    std::uint8_t *pValid
+    )
+    {
+    return decodeRange(pFrames, 0, nFrames, pT, pRH, pValid);
+    }
+
+#endif /* scalar */
+
+} // end anonymous namespace
+
+
+size_t cSHT3xFrames::decode(
+    const std::uint8_t *pFrames, size_t nFrames,
+    float *pT, float *pRH,
+    std::uint8_t *pValid
+    )
+    {
+    return decodeFrames(pFrames, nFrames, pT, pRH, pValid);
+    }
+
+size_t cSHT3xFrames::decode(
+    const std::uint8_t *pFrames, size_t nFrames,
+    std::int32_t *pmT, std::int32_t *pmRH,
+    std::uint8_t *pValid
+    )
+    {
+    return decodeFrames(pFrames, nFrames, pmT, pmRH, pValid);
+    }
+
+size_t cSHT3xFrames::decodeScalar(
+    const std::uint8_t *pFrames, size_t nFrames,
+    float *pT, float *pRH,
+    std::uint8_t *pValid
+    )
+    {
+    return decodeRange(pFrames, 0, nFrames, pT, pRH, pValid);
+    }
+
+size_t cSHT3xFrames::decodeScalar(
+    const std::uint8_t *pFrames, size_t nFrames,
+    std::int32_t *pmT, std::int32_t *pmRH,
+    std::uint8_t *pValid
+    )
+    {
+    return decodeRange(pFrames, 0, nFrames, pmT, pmRH, pValid);
+    }
+
+const char *cSHT3xFrames::getImplementation()
+    {
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSSE3__)
+    return "ssse3";
+#else
+    return "scalar";
+#endif
+    }
@@ -0,0 +1,166 @@
+/*
+
+Module: Catena-SHT3x-Log.cpp
+
+Function:
+        Code for the SHT3x sample log.
+
+Copyright and License:
+        See accompanying LICENSE file.
+
+Author:
+        Terry Moore, MCCI Corporation   June 2019
+
+*/
+
+#include <Catena-SHT3x-Log.h>
+
+#include <cstring>
+
+using namespace McciCatenaSht3x;
+
+
+bool cSHT3xLog::begin(void)
+    {
+    std::uint32_t const nBlocks = this->m_pStorage->getBlockCount();
+    bool fFound = false;
+    std::uint32_t lastSequence = 0;
+
+    if (nBlocks == 0)
+        return false;
+
+    // find the highest sequence number; blocks are written in order,
+    // so the next one follows it.
+    for (std::uint32_t i = 0; i < nBlocks; ++i)
+        {
+        BlockHeader h;
+
+        if (! this->m_pStorage->read(i, 0, &h, sizeof(h)))
+            return false;
+
+        if (h.Magic != kMagic || h.Version != kVersion)
+            continue;
+        if (h.Sequence % nBlocks != i)
+            continue;
+
+        if (! fFound || std::int32_t(h.Sequence - lastSequence) > 0)
+            {
+            fFound = true;
+            lastSequence = h.Sequence;
+            }
+        }
+
+    this->m_sequence = fFound ? lastSequence + 1 : 0;
+    this->m_block.Header.nSamples = 0;
+    this->m_runSamples = 0;
+    return true;
+    }
+
+bool cSHT3xLog::startRun(std::uint64_t msStart, std::uint32_t msPeriod)
+    {
+    bool const fResult = this->flush();
+
+    this->m_runStart = msStart;
+    this->m_runSamples = 0;
+    this->m_periodMs = msPeriod;
+    return fResult;
+    }
+
+bool cSHT3xLog::append(std::uint16_t tBits, std::uint16_t rhBits)
+    {
+    BlockHeader &h = this->m_block.Header;
+
+    if (h.nSamples == 0)
+        {
+        h.StartTime = this->m_runStart + std::uint64_t(this->m_runSamples) * this->m_periodMs;
+        h.PeriodMs = this->m_periodMs;
+        }
+
+    Sample &s = this->m_block.Samples[h.nSamples++];
+    s.TemperatureBits = tBits;
+    s.HumidityBits = rhBits;
+    ++this->m_runSamples;
+
+    if (h.nSamples == kSamplesPerBlock)
+        return this->flush();
+
+    return true;
+    }
+
+bool cSHT3xLog::flush(void)
+    {
+    BlockHeader &h = this->m_block.Header;
+    std::uint32_t const nBlocks = this->m_pStorage->getBlockCount();
+
+    if (h.nSamples == 0)
+        return true;
+    if (nBlocks == 0)
+        return false;
+
+    h.Magic = kMagic;
+    h.Sequence = this->m_sequence;
+    h.Version = kVersion;
+    h.Flags = 0xFF;
+    h.Reserved = 0xFFFFFFFFu;
+
+    // unused samples are left as erased flash.
+    std::memset(
+        &this->m_block.Samples[h.nSamples],
+        0xFF,
+        (kSamplesPerBlock - h.nSamples) * sizeof(Sample)
+        );
+
+    h.Crc = blockCrc(this->m_block);
+
+    bool const fResult = this->m_pStorage->writeBlock(
+                            this->m_sequence % nBlocks,
+                            &this->m_block
+                            );
+
+    // whatever happened, don't rewrite this block.
+    ++this->m_sequence;
+    h.nSamples = 0;
+    return fResult;
+    }
+
+std::uint32_t cSHT3xLog::blockCrc(const cSHT3xLog::Block &block)
+    {
+    std::uint32_t crc;
+
+    crc = crc32(&block.Header, offsetof(BlockHeader, Crc));
+    return crc32(block.Samples, block.Header.nSamples * sizeof(Sample), crc);
+    }
+
+bool cSHT3xLog::isValidBlock(const cSHT3xLog::Block &block)
+    {
+    const BlockHeader &h = block.Header;
+
+    return h.Magic == kMagic &&
+           h.Version == kVersion &&
+           h.nSamples != 0 &&
+           h.nSamples <= kSamplesPerBlock &&
+           h.Crc == blockCrc(block);
+    }
+
+std::uint32_t cSHT3xLog::crc32(const void *pBuf, size_t nBuf, std::uint32_t crc)
+    {
+    // nibble-wide table for the reflected polynomial 0xEDB88320;
+    // same approach as cSHT3x::crc().
+    static const std::uint32_t crcTable[16] =
+        {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+        };
+    const std::uint8_t *p = static_cast<const std::uint8_t *>(pBuf);
+
+    crc = ~crc;
+    for (size_t i = nBuf; i > 0; --i, ++p)
+        {
+        crc = (crc >> 4) ^ crcTable[(crc ^ *p) & 0xF];
+        crc = (crc >> 4) ^ crcTable[(crc ^ (*p >> 4)) & 0xF];
+        }
+
+    return ~crc;
+    }
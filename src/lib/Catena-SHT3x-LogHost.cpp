@@ -0,0 +1,207 @@
+/*
+
+Module: Catena-SHT3x-LogHost.cpp
+
+Function:
+        Host-side (POSIX) storage and reader for the SHT3x sample log.
+
+Copyright and License:
+        See accompanying LICENSE file.
+
+Author:
+        Terry Moore, MCCI Corporation   June 2019
+
+*/
+
+#include <Catena-SHT3x-Log.h>
+
+#if ! defined(ARDUINO)
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace McciCatenaSht3x;
+
+
+bool cSHT3xLogFile::open(const char *pPath, std::uint32_t nBlocks)
+    {
+    std::FILE *pFile;
+    long size;
+
+    this->close();
+
+    pFile = std::fopen(pPath, "r+b");
+    if (pFile == nullptr)
+        pFile = std::fopen(pPath, "w+b");
+    if (pFile == nullptr)
+        return false;
+
+    if (std::fseek(pFile, 0, SEEK_END) != 0 || (size = std::ftell(pFile)) < 0)
+        {
+        std::fclose(pFile);
+        return false;
+        }
+
+    std::uint32_t const nHave = std::uint32_t(size / cSHT3xLog::kBlockSize);
+
+    if (nBlocks == 0)
+        nBlocks = nHave;
+
+    // extend with erased blocks.
+    if (nHave < nBlocks)
+        {
+        std::uint8_t erased[cSHT3xLog::kBlockSize];
+
+        std::memset(erased, 0xFF, sizeof(erased));
+        std::fseek(pFile, long(nHave) * long(sizeof(erased)), SEEK_SET);
+        for (std::uint32_t i = nHave; i < nBlocks; ++i)
+            {
+            if (std::fwrite(erased, sizeof(erased), 1, pFile) != 1)
+                {
+                std::fclose(pFile);
+                return false;
+                }
+            }
+        std::fflush(pFile);
+        }
+
+    this->m_pFile = pFile;
+    this->m_nBlocks = nBlocks;
+    return true;
+    }
+
+void cSHT3xLogFile::close(void)
+    {
+    if (this->m_pFile != nullptr)
+        {
+        std::fclose(static_cast<std::FILE *>(this->m_pFile));
+        this->m_pFile = nullptr;
+        }
+    this->m_nBlocks = 0;
+    }
+
+bool cSHT3xLogFile::read(std::uint32_t iBlock, size_t offset, void *pBuf, size_t nBuf)
+    {
+    std::FILE * const pFile = static_cast<std::FILE *>(this->m_pFile);
+
+    if (pFile == nullptr || iBlock >= this->m_nBlocks ||
+        offset + nBuf > cSHT3xLog::kBlockSize)
+        return false;
+
+    if (std::fseek(pFile, long(iBlock) * long(cSHT3xLog::kBlockSize) + long(offset), SEEK_SET) != 0)
+        return false;
+
+    return std::fread(pBuf, nBuf, 1, pFile) == 1;
+    }
+
+bool cSHT3xLogFile::writeBlock(std::uint32_t iBlock, const void *pBlock)
+    {
+    std::FILE * const pFile = static_cast<std::FILE *>(this->m_pFile);
+
+    if (pFile == nullptr || iBlock >= this->m_nBlocks)
+        return false;
+
+    if (std::fseek(pFile, long(iBlock) * long(cSHT3xLog::kBlockSize), SEEK_SET) != 0)
+        return false;
+
+    if (std::fwrite(pBlock, cSHT3xLog::kBlockSize, 1, pFile) != 1)
+        return false;
+
+    return std::fflush(pFile) == 0;
+    }
+
+bool cSHT3xLogReader::open(const char *pPath, bool fVerify)
+    {
+    int fd;
+    struct stat st;
+
+    this->close();
+
+    fd = ::open(pPath, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    if (::fstat(fd, &st) != 0)
+        {
+        ::close(fd);
+        return false;
+        }
+
+    size_t const nBlocks = size_t(st.st_size) / cSHT3xLog::kBlockSize;
+
+    if (nBlocks == 0)
+        {
+        ::close(fd);
+        return true;
+        }
+
+    this->m_nMap = nBlocks * cSHT3xLog::kBlockSize;
+    this->m_pMap = ::mmap(nullptr, this->m_nMap, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (this->m_pMap == MAP_FAILED)
+        {
+        this->m_pMap = nullptr;
+        this->m_nMap = 0;
+        return false;
+        }
+
+    const cSHT3xLog::Block * const pBlocks = static_cast<const cSHT3xLog::Block *>(this->m_pMap);
+
+    ::madvise(this->m_pMap, this->m_nMap, MADV_SEQUENTIAL);
+    this->m_blocks.reserve(nBlocks);
+
+    for (size_t i = 0; i < nBlocks; ++i)
+        {
+        const cSHT3xLog::Block &block = pBlocks[i];
+        const cSHT3xLog::BlockHeader &h = block.Header;
+
+        if (fVerify)
+            {
+            if (! cSHT3xLog::isValidBlock(block))
+                continue;
+            }
+        else if (h.Magic != cSHT3xLog::kMagic ||
+                 h.nSamples == 0 ||
+                 h.nSamples > cSHT3xLog::kSamplesPerBlock)
+            continue;
+
+        if (h.Sequence % nBlocks != i)
+            continue;
+
+        this->m_blocks.push_back(&block);
+        this->m_nSamples += h.nSamples;
+        }
+
+    // the ring may have wrapped; sequence numbers put it back in order.
+    std::sort(
+        this->m_blocks.begin(),
+        this->m_blocks.end(),
+        [](const cSHT3xLog::Block *pA, const cSHT3xLog::Block *pB)
+            {
+            return pA->Header.Sequence < pB->Header.Sequence;
+            }
+        );
+
+    return true;
+    }
+
+void cSHT3xLogReader::close(void)
+    {
+    if (this->m_pMap != nullptr)
+        {
+        ::munmap(this->m_pMap, this->m_nMap);
+        this->m_pMap = nullptr;
+        this->m_nMap = 0;
+        }
+    this->m_blocks.clear();
+    this->m_nSamples = 0;
+    }
+
+#endif /* ! defined(ARDUINO) */
@@ -0,0 +1,83 @@
+/*
+
+Module: Catena-SHT3x-Replay.cpp
+
+Function:
+        Code for cSHT3xReplay.
+
+Copyright and License:
+        See accompanying LICENSE file.
+
+Author:
+        Terry Moore, MCCI Corporation   June 2019
+
+*/
+
+#include <Catena-SHT3x-Replay.h>
+
+using namespace McciCatenaSht3x;
+
+
+const cSHT3x::BusRecord *cSHT3xReplay::next(
+    cSHT3x::BusOp op,
+    std::uint8_t addr
+    ) const
+    {
+    const BusRecord * const p = this->peek();
+
+    if (p == nullptr || p->Op != op)
+        {
+        ++this->m_nMismatches;
+        return nullptr;
+        }
+
+    ++this->m_iNext;
+    if (p->Address != addr)
+        ++this->m_nMismatches;
+
+    return p;
+    }
+
+std::uint8_t cSHT3xReplay::busWrite(
+    std::uint8_t addr,
+    const std::uint8_t *pBuf,
+    size_t nBuf
+    ) const
+    {
+    const BusRecord * const p = this->next(BusOp::Write, addr);
+
+    if (p == nullptr)
+        return 2;   // as for an address NACK
+
+    bool fMatch = p->nData == nBuf;
+
+    for (size_t i = 0; fMatch && i < nBuf && i < sizeof(p->Data); ++i)
+        fMatch = p->Data[i] == pBuf[i];
+
+    if (! fMatch)
+        ++this->m_nMismatches;
+
+    return p->Result;
+    }
+
+size_t cSHT3xReplay::busRead(
+    std::uint8_t addr,
+    std::uint8_t *pBuf,
+    size_t nBuf,
+    std::uint8_t &nReadFrom
+    ) const
+    {
+    const BusRecord * const p = this->next(BusOp::Read, addr);
+
+    if (p == nullptr)
+        {
+        nReadFrom = 0;
+        return 0;
+        }
+
+    for (size_t i = 0; i < p->nData && i < nBuf && i < sizeof(p->Data); ++i)
+        pBuf[i] = p->Data[i];
+
+    nReadFrom = p->Result;
+    return p->nData;
+    }
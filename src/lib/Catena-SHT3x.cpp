@@ -17,11 +17,67 @@ Author:
 
 using namespace McciCatenaSht3x;
 
+namespace {
+
+// the CRC mismatch for each single-bit error in a data word.
+struct cCrcSyndromes
+    {
+    std::uint8_t v[16];
+
+    constexpr cCrcSyndromes() : v{}
+        {
+        for (unsigned i = 0; i < 16; ++i)
+            v[i] = cSHT3x::getCrcSyndrome(i);
+        }
+    };
+
+constexpr cCrcSyndromes kCrcSyndromes {};
+
+} // end anonymous namespace
 
 bool cSHT3x::begin(void)
     {
     this->m_wire->begin();
-    return this->reset();
+    this->applyBusClock();
+
+    // clear the reset flag, so that beginFast() can later tell whether
+    // the sensor has been reset.
+    return this->reset() && this->writeCommand(Command::ClearStatus);
+    }
+
+bool cSHT3x::beginFast(Command cRetained)
+    {
+    bool const fPeriodic = this->PeriodicityToMillis(this->getPeriodicity(cRetained)) != 0;
+
+    this->m_wire->begin();
+    this->applyBusClock();
+
+    Status_t const s = this->getStatus();
+
+    if (! s.isValid())
+        {
+        // no answer, or a bad answer: do it the slow way.
+        if (! this->reset())
+            return false;
+        }
+    else if (! s.isSystemResetDetected())
+        {
+        // the sensor has kept running since we last cleared the
+        // status, so it is still in the mode we left it in. We don't
+        // know when its periods end, though.
+        this->m_periodicCommand = fPeriodic ? cRetained : Command::Error;
+        this->m_fPeriodicPhaseKnown = false;
+        return true;
+        }
+
+    // the sensor has just come out of reset, and so is idle.
+    if (! this->writeCommand(Command::ClearStatus))
+        return false;
+
+    if (fPeriodic)
+        return this->startPeriodic(cRetained, /* fBreak */ false) != 0;
+
+    return true;
     }
 
 void cSHT3x::end(void)
@@ -33,6 +89,7 @@ bool cSHT3x::reset(void) const
     {
     if (this->writeCommand(Command::SoftReset))
         {
+        this->m_periodicCommand = Command::Error;
         delay(10);
         return true;
         }
@@ -44,6 +101,7 @@ cSHT3x::Status_t cSHT3x::getStatus() const
     {
     bool ok;
     std::uint8_t buf[3];
+    std::uint16_t bits = 0;
 
     ok = this->writeCommand(Command::GetStatus);
 
@@ -52,12 +110,41 @@ cSHT3x::Status_t cSHT3x::getStatus() const
         ok = this->readResponse(buf, sizeof(buf));
         }
 
+    if (ok)
+        {
+        bits = (buf[0] << 8) | buf[1];
+        }
+
     if (ok && ! this->m_noCrc)
-        ok = this->crc(buf, 2) == buf[2];
+        {
+        CrcCheck const check = this->checkCrc(bits, buf[2]);
+
+        ok = check != CrcCheck::Bad;
+        this->m_fLastCrcCorrected = check == CrcCheck::Corrected;
+        this->trace(
+            TraceEvent::CheckCrc,
+            ok ? (this->m_fLastCrcCorrected ? 1 << 4 : 0) : 1,
+            1,
+            ok ? 1 : 0
+            );
+        if (! ok)
+            {
+            ++this->m_nCrcErrors;
+            if (this->m_fCrcCorrect)
+                ++this->m_nCrcUncorrectable;
+            }
+        else if (this->m_fLastCrcCorrected)
+            ++this->m_nCrcCorrected;
+        this->noteBusResult(
+            check == CrcCheck::Ok        ? BusResult::Ok :
+            check == CrcCheck::Corrected ? BusResult::Marginal :
+                                           BusResult::Error
+            );
+        }
 
     if (ok)
         {
-        return Status_t((buf[0] << 8) | buf[1]);
+        return Status_t(bits);
         }
     else
         {
@@ -112,6 +199,7 @@ bool cSHT3x::getTemperatureHumidity(
     else
         {
         m.Temperature = m.Humidity = NAN;
+        m.CrcCorrected = false;
         }
 
     return fResult;
@@ -139,15 +227,12 @@ bool cSHT3x::getTemperatureHumidityRaw(
     cSHT3x::Repeatability r
     ) const
     {
-    bool fResult;
     Command const c = this->getCommand(
                             Periodicity::Single,
                             r,
                             ClockStretching::Disabled
                             );
 
-    fResult = true;
-
     if (c == Command::Error)
         {
         if (this->isDebug())
@@ -155,23 +240,32 @@ bool cSHT3x::getTemperatureHumidityRaw(
             Serial.print("getTemperatureHumidityRaw: Illegal repeatability: ");
             Serial.println(static_cast<int>(r));
             }
-        fResult = false;
+        return false;
         }
 
+    return this->getSingleMeasurementRaw(c, mRaw);
+    }
+
+bool cSHT3x::getSingleMeasurementRaw(
+    cSHT3x::Command c,
+    cSHT3x::MeasurementsRaw &mRaw
+    ) const
+    {
+    bool fResult;
     std::uint8_t buf[6];
 
-    if (fResult)
+    fResult = this->writeCommand(c);
+    if (this->isDebug() && ! fResult)
         {
-        fResult = this->writeCommand(c);
-        if (this->isDebug() && ! fResult)
-            {
-            Serial.println("getTemperatureHumidityRaw: writeCommand failed");
-            }
+        Serial.println("getTemperatureHumidityRaw: writeCommand failed");
         }
 
     if (fResult)
         {
-        delay(20);
+        // with clock stretching, the device holds the bus until the
+        // measurement is ready, so there's no need to wait.
+        if (this->getClockStretching(c) == ClockStretching::Disabled)
+            delay(kSingleShotWaitMs);
         fResult = this->readResponse(buf, sizeof(buf));
         if (this->isDebug() && ! fResult)
             {
@@ -188,10 +282,18 @@ bool cSHT3x::getTemperatureHumidityRaw(
             }
         }
 
+    if (fResult)
+        this->updateCache(mRaw, millis(), this->getRepeatability(c));
+
     return fResult;
     }
 
 std::uint32_t cSHT3x::startPeriodicMeasurement(Command c) const
+    {
+    return this->startPeriodic(c, /* fBreak */ true);
+    }
+
+std::uint32_t cSHT3x::startPeriodic(Command c, bool fBreak) const
     {
     std::uint32_t result = this->PeriodicityToMillis(this->getPeriodicity(c));
 
@@ -202,16 +304,204 @@ std::uint32_t cSHT3x::startPeriodicMeasurement(Command c) const
     // ok.
 
     // break any previous measurement
-    if (! this->writeCommand(Command::Break))
-        return 0;
+    if (fBreak)
+        {
+        this->m_periodicCommand = Command::Error;
+        if (! this->writeCommand(Command::Break))
+            return 0;
+        }
 
     // start this measurement
     if (! this->writeCommand(c))
         return 0;
 
+    this->m_periodicCommand = c;
+    this->m_periodicStart = millis();
+    this->m_fPeriodicPhaseKnown = true;
     return result;
     }
 
+bool cSHT3x::planSampling(
+    const cSHT3x::SamplingRequirements &req,
+    cSHT3x::SamplingPlan &plan
+    )
+    {
+    static constexpr ClockStretching kStretching[] =
+        { ClockStretching::Disabled, ClockStretching::Enabled };
+    static constexpr Periodicity kPeriodicity[] =
+        {
+        Periodicity::Single,
+        Periodicity::HzHalf, Periodicity::HzOne, Periodicity::HzTwo,
+        Periodicity::HzFour, Periodicity::HzTen,
+        };
+    static constexpr Repeatability kRepeatability[] =
+        { Repeatability::Low, Repeatability::Medium, Repeatability::High };
+
+    if (req.msInterval == 0)
+        return false;
+
+    // we can't run the bus slower than the slowest step.
+    if (req.maxBusClock != 0 && req.maxBusClock < getBusClockStep(0))
+        {
+        plan.command = Command::Error;
+        return false;
+        }
+
+    std::uint32_t const busClock = getBusClockStep(
+                                        busClockToStep(req.maxBusClock == 0 ? getBusClockStep(kBusClockSteps - 1)
+                                                                            : req.maxBusClock)
+                                        );
+    // one command write and one 6-byte read: (1 + 2) + (1 + 6) bytes of
+    // 9 bits, plus start and stop for each transfer.
+    float const usBus = ((3 * 9 + 2) + (7 * 9 + 2)) * 1e6f / busClock;
+    float const samplesPerHour = 3600000.0f / req.msInterval;
+    bool fFound = false;
+
+    for (Repeatability const r : kRepeatability)
+        {
+        if (r < req.repeatability)
+            continue;
+
+        for (Periodicity const p : kPeriodicity)
+            {
+            std::uint32_t const msPeriod = PeriodicityToMillis(p);
+
+            // the device must sample at least as often as required.
+            if (p != Periodicity::Single && msPeriod > req.msInterval)
+                continue;
+
+            for (ClockStretching const s : kStretching)
+                {
+                Command const c = getCommand(p, r, s);
+
+                if (c == Command::Error)
+                    continue;
+
+                float duty;
+                float idleMicroAmps;
+                float usBusPerSample = usBus;
+                float usLatency = usBus;
+
+                if (p == Periodicity::Single)
+                    {
+                    idleMicroAmps = kSingleIdleMicroAmps;
+                    duty = getMeasurementMicros(r, false) / (req.msInterval * 1000.0f);
+
+                    if (s == ClockStretching::Enabled)
+                        {
+                        usBusPerSample += getMeasurementMicros(r, true);
+                        usLatency += getMeasurementMicros(r, true);
+                        }
+                    else
+                        // getSingleMeasurementRaw() waits
+                        usLatency += kSingleShotWaitMs * 1000;
+
+                    // each sample must finish before the next is due.
+                    if (usLatency > req.msInterval * 1000.0f)
+                        continue;
+                    }
+                else
+                    {
+                    idleMicroAmps = kPeriodicIdleMicroAmps;
+                    duty = getMeasurementMicros(r, false) / (msPeriod * 1000.0f);
+                    }
+
+                // the sensor can't measure more than all the time.
+                if (duty > 1.0f)
+                    duty = 1.0f;
+
+                float const uaAverage = idleMicroAmps +
+                                        (kMeasureMicroAmps - idleMicroAmps) * duty;
+                float const busMsPerHour = samplesPerHour * usBusPerSample / 1000.0f;
+                std::uint32_t const msLatency = std::uint32_t((usLatency + 999.0f) / 1000.0f);
+
+                if (msLatency > req.msLatency)
+                    continue;
+
+                // cheapest current; then least bus time; then lowest latency.
+                if (fFound)
+                    {
+                    if (uaAverage > plan.uaAverage)
+                        continue;
+                    if (uaAverage == plan.uaAverage)
+                        {
+                        if (busMsPerHour > plan.busMsPerHour)
+                            continue;
+                        if (busMsPerHour == plan.busMsPerHour && msLatency >= plan.msLatency)
+                            continue;
+                        }
+                    }
+
+                fFound = true;
+                plan.command = c;
+                plan.busClock = busClock;
+                plan.msLatency = msLatency;
+                plan.uaAverage = uaAverage;
+                plan.busMsPerHour = busMsPerHour;
+                }
+            }
+        }
+
+    if (! fFound)
+        plan.command = Command::Error;
+
+    return fFound;
+    }
+
+bool cSHT3x::applySamplingPlan(const cSHT3x::SamplingPlan &plan)
+    {
+    Periodicity const p = this->getPeriodicity(plan.command);
+
+    if (p == Periodicity::Error)
+        return false;
+
+    this->setBusClock(plan.busClock);
+    this->m_planCommand = plan.command;
+
+    if (p != Periodicity::Single)
+        return this->startPeriodicMeasurement(plan.command) != 0;
+
+    // leave periodic mode, if need be.
+    if (this->m_periodicCommand != Command::Error)
+        {
+        this->m_periodicCommand = Command::Error;
+        if (! this->writeCommand(Command::Break))
+            return false;
+        delay(1);
+        }
+
+    return true;
+    }
+
+bool cSHT3x::getMeasurement(cSHT3x::Measurements &m) const
+    {
+    MeasurementsRaw mRaw;
+    bool fResult;
+
+    fResult = this->getMeasurementRaw(mRaw);
+    if (fResult)
+        m.set(mRaw);
+    else
+        {
+        m.Temperature = m.Humidity = NAN;
+        m.CrcCorrected = false;
+        }
+
+    return fResult;
+    }
+
+bool cSHT3x::getMeasurementRaw(cSHT3x::MeasurementsRaw &mRaw) const
+    {
+    Periodicity const p = this->getPeriodicity(this->m_planCommand);
+
+    if (p == Periodicity::Single)
+        return this->getSingleMeasurementRaw(this->m_planCommand, mRaw);
+    else if (p != Periodicity::Error)
+        return this->getPeriodicMeasurementRaw(mRaw);
+    else
+        return this->getTemperatureHumidityRaw(mRaw);
+    }
+
 bool cSHT3x::getPeriodicMeasurement(float &t, float &rh) const
     {
     bool fResult;
@@ -267,6 +557,174 @@ bool cSHT3x::getPeriodicMeasurementRaw(cSHT3x::MeasurementsRaw &mRaw) const
         fResult = this->readResponse(buf, sizeof(buf));
     if (fResult)
         fResult = this->processResultsRaw(buf, mRaw);
+    if (fResult)
+        this->updateCache(
+            mRaw,
+            this->getPeriodicSampleTime(millis()),
+            this->getRepeatability(this->m_periodicCommand)
+            );
+
+    return fResult;
+    }
+
+// return the time at which the most recent periodic sample was complete:
+// the end of the last whole period. If we don't know when the periods
+// began, assume the worst.
+std::uint32_t cSHT3x::getPeriodicSampleTime(std::uint32_t now) const
+    {
+    std::uint32_t const msPeriod = this->PeriodicityToMillis(this->getPeriodicity(this->m_periodicCommand));
+
+    if (msPeriod == 0)
+        return now;
+    if (! this->m_fPeriodicPhaseKnown)
+        return now - msPeriod;
+
+    return now - (now - this->m_periodicStart) % msPeriod;
+    }
+
+cSHT3x::CacheStatus cSHT3x::requestCachedRaw(
+    cSHT3x::MeasurementsRaw &mRaw,
+    std::uint32_t msMaxAge,
+    cSHT3x::Repeatability r
+    ) const
+    {
+    std::uint32_t const now = millis();
+    bool const fPeriodic = this->m_periodicCommand != Command::Error;
+
+    // a sample that's less repeatable than asked for is no good; but in
+    // periodic mode, the mode decides.
+    if (this->m_fCacheValid &&
+        (fPeriodic || this->m_cacheRepeatability >= r) &&
+        now - this->m_cacheTime <= msMaxAge)
+        {
+        ++this->m_nCacheHits;
+        mRaw = this->m_cache;
+        return CacheStatus::Ready;
+        }
+
+    // in periodic mode, the latest result is available right away; but
+    // if the cached one is from the current period, there is no newer
+    // one, and a fetch would just be NACKed.
+    if (fPeriodic)
+        {
+        if (this->m_fCacheValid &&
+            std::int32_t(this->m_cacheTime - this->getPeriodicSampleTime(now)) >= 0)
+            {
+            ++this->m_nCacheHits;
+            mRaw = this->m_cache;
+            return CacheStatus::Ready;
+            }
+
+        std::uint32_t const nNoData = this->m_nNoData;
+
+        ++this->m_nCacheMisses;
+        if (this->getPeriodicMeasurementRaw(mRaw))
+            return CacheStatus::Ready;
+
+        // no new data after all (e.g. the measurement is still running);
+        // the cached sample is still the newest.
+        if (this->m_nNoData != nNoData && this->m_fCacheValid)
+            {
+            mRaw = this->m_cache;
+            return CacheStatus::Ready;
+            }
+
+        return CacheStatus::Error;
+        }
+
+    if (this->m_fCachePending && this->m_cachePendingRepeatability >= r)
+        {
+        std::uint32_t const msPending = now - this->m_cachePendingTime;
+
+        // someone else has already started a measurement; join it,
+        // unless its result has been waiting longer than we'd accept.
+        // (If it's less repeatable than we need, we start another,
+        // which the other caller can join in turn.)
+        if (msPending < kSingleShotWaitMs)
+            {
+            ++this->m_nCacheCoalesced;
+            return CacheStatus::Pending;
+            }
+        else if (msPending - kSingleShotWaitMs <= msMaxAge)
+            {
+            ++this->m_nCacheCoalesced;
+            return this->completeCached(mRaw) ? CacheStatus::Ready : CacheStatus::Error;
+            }
+        }
+
+    ++this->m_nCacheMisses;
+
+    Command const c = this->getCommand(Periodicity::Single, r, ClockStretching::Disabled);
+
+    if (c == Command::Error || ! this->writeCommand(c))
+        return CacheStatus::Error;
+
+    this->m_fCachePending = true;
+    this->m_cachePendingTime = now;
+    this->m_cachePendingRepeatability = r;
+    return CacheStatus::Pending;
+    }
+
+bool cSHT3x::getCachedRaw(
+    cSHT3x::MeasurementsRaw &mRaw,
+    std::uint32_t msMaxAge,
+    cSHT3x::Repeatability r
+    ) const
+    {
+    CacheStatus const status = this->requestCachedRaw(mRaw, msMaxAge, r);
+
+    if (status != CacheStatus::Pending)
+        return status == CacheStatus::Ready;
+
+    // wait out the rest of the measurement.
+    std::uint32_t const elapsed = millis() - this->m_cachePendingTime;
+
+    if (elapsed < kSingleShotWaitMs)
+        delay(kSingleShotWaitMs - elapsed);
+
+    return this->completeCached(mRaw);
+    }
+
+bool cSHT3x::getCached(
+    cSHT3x::Measurements &m,
+    std::uint32_t msMaxAge,
+    cSHT3x::Repeatability r
+    ) const
+    {
+    MeasurementsRaw mRaw;
+    bool fResult;
+
+    fResult = this->getCachedRaw(mRaw, msMaxAge, r);
+    if (fResult)
+        m.set(mRaw);
+    else
+        {
+        m.Temperature = m.Humidity = NAN;
+        m.CrcCorrected = false;
+        }
+
+    return fResult;
+    }
+
+bool cSHT3x::completeCached(cSHT3x::MeasurementsRaw &mRaw) const
+    {
+    std::uint8_t buf[6];
+    bool fResult;
+
+    this->m_fCachePending = false;
+
+    fResult = this->readResponse(buf, sizeof(buf));
+    if (fResult)
+        fResult = this->processResultsRaw(buf, mRaw);
+
+    // the measurement was complete kSingleShotWaitMs after it started,
+    // however long it then waited to be read.
+    if (fResult)
+        this->updateCache(
+            mRaw,
+            this->m_cachePendingTime + kSingleShotWaitMs,
+            this->m_cachePendingRepeatability
+            );
 
     return fResult;
     }
@@ -295,17 +753,85 @@ bool cSHT3x::processResultsRaw(
     mRaw.TemperatureBits = (buf[0] << 8) | buf[1];
     mRaw.HumidityBits = (buf[3] << 8) | buf[4];
 
+    mRaw.CrcCorrected = false;
+    this->m_fLastCrcCorrected = false;
+
     // check CRC? use a flag to control
     if (! this->m_noCrc)
         {
-        if (this->crc(buf, 2) != buf[2] ||
-            this->crc(buf + 3, 2) != buf[5])
-                return false;
+        CrcCheck const checkT = this->checkCrc(mRaw.TemperatureBits, buf[2]);
+        CrcCheck const checkRH = this->checkCrc(mRaw.HumidityBits, buf[5]);
+        std::uint8_t badMask = 0;
+        std::uint8_t correctedMask = 0;
+
+        if (checkT == CrcCheck::Bad)
+            badMask |= 1 << 0;
+        else if (checkT == CrcCheck::Corrected)
+            correctedMask |= 1 << 0;
+
+        if (checkRH == CrcCheck::Bad)
+            badMask |= 1 << 1;
+        else if (checkRH == CrcCheck::Corrected)
+            correctedMask |= 1 << 1;
+
+        this->trace(
+            TraceEvent::CheckCrc,
+            badMask | (correctedMask << 4),
+            2,
+            2 - ((badMask & 1) + (badMask >> 1))
+            );
+
+        if (badMask != 0)
+            {
+            ++this->m_nCrcErrors;
+            if (this->m_fCrcCorrect)
+                ++this->m_nCrcUncorrectable;
+            this->noteBusResult(BusResult::Error);
+            return false;
+            }
+
+        if (correctedMask != 0)
+            {
+            // good enough to use, but the bus is still noisy.
+            ++this->m_nCrcCorrected;
+            mRaw.CrcCorrected = true;
+            this->m_fLastCrcCorrected = true;
+            this->noteBusResult(BusResult::Marginal);
+            return true;
+            }
         }
 
+    this->noteBusResult(BusResult::Ok);
     return true;
     }
 
+cSHT3x::CrcCheck cSHT3x::checkCrc(std::uint16_t &word, std::uint8_t crc8) const
+    {
+    std::uint8_t const buf[2] = { std::uint8_t(word >> 8), std::uint8_t(word) };
+    std::uint8_t const syndrome = this->crc(buf, 2) ^ crc8;
+
+    if (syndrome == 0)
+        return CrcCheck::Ok;
+
+    if (! this->m_fCrcCorrect)
+        return CrcCheck::Bad;
+
+    // a single-bit error in the CRC byte: the data is fine.
+    if ((syndrome & (syndrome - 1)) == 0)
+        return CrcCheck::Corrected;
+
+    for (unsigned i = 0; i < 16; ++i)
+        {
+        if (kCrcSyndromes.v[i] == syndrome)
+            {
+            word ^= std::uint16_t(1u << i);
+            return CrcCheck::Corrected;
+            }
+        }
+
+    return CrcCheck::Bad;
+    }
+
 bool cSHT3x::writeCommand(Command c) const
     {
     std::uint16_t const cbits = static_cast<std::uint16_t>(c);
@@ -320,10 +846,19 @@ bool cSHT3x::writeCommand(Command c) const
         return false;
         }
 
-    this->m_wire->beginTransmission(addr);
-    this->m_wire->write(std::uint8_t(cbits >> 8));
-    this->m_wire->write(std::uint8_t(cbits & 0xFF));
-    result = this->m_wire->endTransmission();
+    std::uint8_t const cmd[2] = { std::uint8_t(cbits >> 8), std::uint8_t(cbits & 0xFF) };
+
+    // any command abandons a single-shot measurement left pending by
+    // requestCachedRaw(); its result can no longer be read.
+    this->m_fCachePending = false;
+
+    result = this->busWrite(std::uint8_t(addr), cmd, sizeof(cmd));
+    this->capture(BusOp::Write, std::uint8_t(addr), result, cmd, sizeof(cmd));
+
+    this->m_lastCommand = c;
+    if (this->m_pTrace != nullptr)
+        this->m_pTrace->setCommand(cbits);
+    this->trace(TraceEvent::WriteCommand, result, 2, result == 0 ? 2 : 0);
 
     if (result != 0)
         {
@@ -342,8 +877,7 @@ bool cSHT3x::writeCommand(Command c) const
 
 bool cSHT3x::readResponse(std::uint8_t *buf, size_t nBuf) const
     {
-    bool ok;
-    unsigned nResult;
+    size_t nResult;
     const std::int8_t addr = this->getAddress();
     uint8_t nReadFrom;
 
@@ -355,7 +889,8 @@ bool cSHT3x::readResponse(std::uint8_t *buf, size_t nBuf) const
         return false;
         }
 
-    nReadFrom = this->m_wire->requestFrom(std::uint8_t(addr), /* bytes */ std::uint8_t(nBuf));
+    nResult = this->busRead(std::uint8_t(addr), buf, nBuf, nReadFrom);
+    this->capture(BusOp::Read, std::uint8_t(addr), nReadFrom, buf, nResult < nBuf ? nResult : nBuf);
 
     if (nReadFrom != nBuf)
         {
@@ -368,10 +903,19 @@ bool cSHT3x::readResponse(std::uint8_t *buf, size_t nBuf) const
             Serial.println(")");
             }
         }
-    nResult = this->m_wire->available();
+    this->trace(TraceEvent::ReadResponse, nReadFrom, std::uint8_t(nBuf), std::uint8_t(nResult));
 
-    for (unsigned i = 0; i < nResult; ++i)
-        buf[i] = this->m_wire->read();
+    if (nResult == 0 && this->m_lastCommand == Command::Fetch)
+        {
+        // in periodic mode, the device NACKs a fetch when there's no new
+        // sample yet. That's not a bus problem.
+        ++this->m_nNoData;
+        }
+    else if (nResult != nBuf)
+        {
+        ++this->m_nShortReads;
+        this->noteBusResult(BusResult::Error);
+        }
 
     if (nResult != nBuf && this->isDebug())
         {
@@ -385,6 +929,213 @@ bool cSHT3x::readResponse(std::uint8_t *buf, size_t nBuf) const
     return (nResult == nBuf);
     }
 
+std::uint8_t cSHT3x::busWrite(std::uint8_t addr, const std::uint8_t *pBuf, size_t nBuf) const
+    {
+    this->m_wire->beginTransmission(addr);
+    this->m_wire->write(pBuf, nBuf);
+    return this->m_wire->endTransmission();
+    }
+
+size_t cSHT3x::busRead(std::uint8_t addr, std::uint8_t *pBuf, size_t nBuf, std::uint8_t &nReadFrom) const
+    {
+    size_t nResult;
+
+    nReadFrom = this->m_wire->requestFrom(addr, /* bytes */ std::uint8_t(nBuf));
+    nResult = this->m_wire->available();
+
+    // drain everything, but don't overrun the buffer.
+    for (size_t i = 0; i < nResult; ++i)
+        {
+        std::uint8_t const b = this->m_wire->read();
+
+        if (i < nBuf)
+            pBuf[i] = b;
+        }
+
+    return nResult;
+    }
+
+void cSHT3x::setBusClock(std::uint32_t hz)
+    {
+    std::uint8_t step = busClockToStep(hz);
+
+    if (step > this->m_busClockLimit)
+        step = this->m_busClockLimit;
+
+    this->m_busClockStep = step;
+    this->resetBusTuning();
+    this->applyBusClock();
+    }
+
+void cSHT3x::setBusClockLimit(std::uint32_t hz)
+    {
+    this->m_busClockLimit = busClockToStep(hz);
+    this->resetBusTuning();
+
+    if (this->m_busClockStep != kBusClockUnmanaged &&
+        this->m_busClockStep > this->m_busClockLimit)
+        {
+        this->m_busClockStep = this->m_busClockLimit;
+        this->applyBusClock();
+        }
+    }
+
+void cSHT3x::setBusClockTuning(bool fEnable)
+    {
+    this->m_fBusTuning = fEnable;
+    this->resetBusTuning();
+
+    // start tuning from the slowest clock.
+    if (fEnable && this->m_busClockStep == kBusClockUnmanaged)
+        {
+        this->m_busClockStep = 0;
+        this->applyBusClock();
+        }
+    }
+
+void cSHT3x::applyBusClock() const
+    {
+    if (this->m_busClockStep != kBusClockUnmanaged)
+        this->m_wire->setClock(getBusClockStep(this->m_busClockStep));
+    }
+
+// called once per transfer with the outcome (short reads and CRC
+// failures are errors, corrected CRCs are marginal). Step down as soon
+// as the error budget for a window is exceeded, and step up after a
+// clean window. If the same clock keeps failing, lower the limit so
+// that we settle below it; but after a long clean run at the limit,
+// raise it again, so that one bad patch doesn't cap the bus for good.
+void cSHT3x::noteBusResult(cSHT3x::BusResult result) const
+    {
+    if (! this->m_fBusTuning)
+        return;
+
+    ++this->m_busWindowCount;
+    if (result == BusResult::Error)
+        this->m_busWindowErrors += 2;
+    else if (result == BusResult::Marginal)
+        this->m_busWindowErrors += 1;
+
+    if (this->m_busWindowErrors >= 2 * kBusErrorsMax)
+        {
+        std::uint8_t const step = this->m_busClockStep;
+
+        if (step == this->m_busFailStep)
+            ++this->m_busFailCount;
+        else
+            {
+            this->m_busFailStep = step;
+            this->m_busFailCount = 1;
+            }
+
+        // at the slowest clock, there's nothing to back off to.
+        if (step > 0)
+            {
+            --this->m_busClockStep;
+
+            if (this->m_busFailCount >= kBusStepFailuresMax &&
+                this->m_busClockLimit > this->m_busClockStep)
+                {
+                this->m_busClockLimit = this->m_busClockStep;
+                this->m_busFailCount = 0;
+                }
+            }
+
+        this->m_busWindowCount = this->m_busWindowErrors = 0;
+        this->m_busCleanWindows = 0;
+        this->applyBusClock();
+        }
+    else if (this->m_busWindowCount >= kBusWindow)
+        {
+        if (this->m_busWindowErrors == 0)
+            {
+            if (this->m_busClockStep < this->m_busClockLimit)
+                {
+                ++this->m_busClockStep;
+                this->applyBusClock();
+                }
+            else if (this->m_busClockLimit < kBusClockSteps - 1 &&
+                     ++this->m_busCleanWindows >= kBusReprobeWindows)
+                {
+                // retry the next clock up on the following clean window.
+                ++this->m_busClockLimit;
+                this->m_busCleanWindows = 0;
+                }
+            }
+        else
+            this->m_busCleanWindows = 0;
+
+        this->m_busWindowCount = this->m_busWindowErrors = 0;
+        }
+    }
+
+void cSHT3x::BusCapture::put(
+    cSHT3x::BusOp op,
+    std::uint8_t addr,
+    std::uint8_t result,
+    const std::uint8_t *pData,
+    size_t nData
+    )
+    {
+    if (this->m_nRecords == this->m_nCapacity)
+        {
+        ++this->m_nDropped;
+        return;
+        }
+
+    BusRecord &r = this->m_pBuf[this->m_nRecords++];
+
+    r.Timestamp = micros();
+    r.Op = op;
+    r.Address = addr;
+    r.Result = result;
+    r.nData = std::uint8_t(nData);
+
+    for (size_t i = 0; i < sizeof(r.Data); ++i)
+        r.Data[i] = i < nData ? pData[i] : 0;
+    }
+
+bool cSHT3x::Trace::get(size_t i, cSHT3x::TraceRecord &r) const
+    {
+    if (i >= this->size())
+        return false;
+
+    // once wrapped, the oldest record is the next one to be overwritten.
+    if (this->m_nTotal > this->m_nRecords)
+        {
+        i += this->m_iNext;
+        if (i >= this->m_nRecords)
+            i -= this->m_nRecords;
+        }
+
+    r = this->m_pBuf[i];
+    return true;
+    }
+
+void cSHT3x::Trace::put(
+    cSHT3x::TraceEvent e,
+    std::uint8_t result,
+    std::uint8_t nRequested,
+    std::uint8_t nActual
+    )
+    {
+    if (this->m_nRecords == 0)
+        return;
+
+    TraceRecord &r = this->m_pBuf[this->m_iNext];
+
+    r.Timestamp = std::uint16_t(millis());
+    r.Command = this->m_Command;
+    r.Event = e;
+    r.Result = result;
+    r.nRequested = nRequested;
+    r.nActual = nActual;
+
+    if (++this->m_iNext == this->m_nRecords)
+        this->m_iNext = 0;
+    ++this->m_nTotal;
+    }
+
 std::uint8_t cSHT3x::crc(const std::uint8_t * buf, size_t nBuf, std::uint8_t crc8)
     {
     /* see CRC-8-Calc.md for a little info on this */